@@ -9,3 +9,15 @@ struct Control
     float forward { 0.0f };
     float right { 0.0f };
 };
+
+// Per tick input of all legs, kept as structure of arrays
+// so every stage of Mover::update runs over all legs at once
+struct LegInput
+{
+    // locomotion vector in body frame, it always lies in XY plane
+    float locomotionX[NUM_LEGS] {};
+    float locomotionY[NUM_LEGS] {};
+    float elevation[NUM_LEGS] {};
+    // as returned by Gait::evaluate
+    float phase[NUM_LEGS] {};
+};
@@ -1,6 +1,7 @@
 #include "Mover.h"
 #include "Controller.h"
 #include "InputHandler.h"
+#include "SerialServos.h"
 
 #include <MathUtils.h>
 
@@ -32,6 +33,15 @@ namespace
 }
 
 unsigned long lastFrame = 0;
+#if IK_INCREMENTAL && defined( DEBUG_TRACE )
+unsigned long lastIkStats = 0;
+#endif
+#if SERVO_SLEW && defined( DEBUG_TRACE )
+unsigned long lastSlewStats = 0;
+#endif
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL && defined( DEBUG_TRACE )
+unsigned long lastSerialStats = 0;
+#endif
 Mover mover;
 Controller controller;
 
@@ -168,4 +178,35 @@ void loop()
         input.update( dt );
         mover.update( dt );
     }
+
+#if IK_INCREMENTAL && defined( DEBUG_TRACE )
+    if( currFrame - lastIkStats >= 5000 )
+    {
+        lastIkStats = currFrame;
+        Leg::printIkStats();
+    }
+#endif
+
+#if SERVO_SLEW && defined( DEBUG_TRACE )
+    // legs whose servos are driven at their slew limits
+    if( currFrame - lastSlewStats >= 5000 )
+    {
+        lastSlewStats = currFrame;
+        Serial.print( "Slew saturations:" );
+        for( int leg = 0; leg < NUM_LEGS; ++leg )
+        {
+            Serial.print( " " );
+            Serial.print( mover.getSlewSaturations( leg ) );
+        }
+        Serial.println();
+    }
+#endif
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL && defined( DEBUG_TRACE )
+    if( currFrame - lastSerialStats >= 5000 )
+    {
+        lastSerialStats = currFrame;
+        SerialServos::printStats();
+    }
+#endif
 }
\ No newline at end of file
@@ -3,58 +3,390 @@
 #include "Arduino.h"
 
 #include <LineSegment.h>
+#include <ConstMath.h>
+#include <StaticTable.h>
+
+#include <float.h>
 
 #define USE_GAIT_MIXER 1
 
+// Phase table resolution in samples per period, trades flash for accuracy (NUM_LEGS uint16_t per sample
+// and gait): multiples of 6 put the swing / stance corners of all fixed gaits onto samples and are exact
+// up to the Q15 storage, other sizes interpolate across the corners: 64 - 0.017, 128 - 0.0083
+#define GAIT_TABLE_SIZE 48
+// Compilation fails if the estimated max table error exceeds this bound, phase units
+#define GAIT_TABLE_MAX_ERROR 0.001
+
+// CPG engine: coupling strength of the oscillators, phase errors decay by e every 1 / CPG_COUPLING cycles
+// while the rates stay within [0; CPG_RATE_MAX].  A leg never runs backwards and never steps faster than
+// CPG_RATE_MAX times its pattern speed, a larger rate settles sooner but moves the leg faster
+#ifndef CPG_COUPLING
+#define CPG_COUPLING 6
+#endif
+#ifndef CPG_RATE_MAX
+#define CPG_RATE_MAX 2
+#endif
+
 namespace
 {
     using Segment = LineSegment<float>;
-    using Curve = Polyline<float, 3>;
+    // swing and stance at most
+    using Curve = Polyline<float, 2>;
 
-    const float waveGaitOnAsc = F_TOLERANCE;
-    const float waveGaitOnDesc = 0.2f;
+    constexpr float waveGaitOnAsc = F_TOLERANCE;
+    constexpr float waveGaitOnDesc = 0.2f;
 
-    const float rippleGaitOnAsc = 0.4f;
-    const float rippleGaitOnDesc = 0.8f;
+    constexpr float rippleGaitOnAsc = 0.4f;
+    constexpr float rippleGaitOnDesc = 0.8f;
 
-    const float tripodGaitOnAsc = 0.95f;
-    const float tripodGaitOnDesc = 1.0f;
+    constexpr float tripodGaitOnAsc = 0.95f;
+    constexpr float tripodGaitOnDesc = 1.0f;
 
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
     // Do not allow switching gait frequently
     const float minGaitUptime = 2.0f;
+#endif
 
-    class SwitchingGait : public Gait
+    // Fixed gaits are data: a descriptor each, evaluated at compile time into the phase tables
+    // and the flash parameters of the generic gait, and their edges in the transition graph below.
+    // Gait time is in the units of the period, leg offsets are cycle starts in gait time
+    struct GaitDescriptor
     {
-    public:
-        enum Type
+        double period;
+        // part of the period a leg is in stance
+        double dutyFactor;
+        // phase change per gait time unit in stance, gait time runs 1 / stanceSlope faster
+        double stanceSlope;
+        double offsets[NUM_LEGS];
+    };
+
+    // Indices of GAITS, idle and mixer are the other states of the gait engine
+    enum GaitId : uint8_t
+    {
+        Wave,
+        Ripple,
+        Tripod,
+
+        GAIT_COUNT,
+        Idle = GAIT_COUNT,
+        Mixer
+    };
+
+    static constexpr GaitDescriptor GAITS[GAIT_COUNT] = {
+        /*Wave*/   { 6.0, 5.0 / 6.0, 0.2,  { 0, 1, 2, 3, 4, 5 } },
+        /*Ripple*/ { 6.0, 4.0 / 6.0, 0.25, { 0, 2, 4, 1, 3, 5 } },
+        /*Tripod*/ { 2.0, 0.5,       0.75, { 0, 1, 0, 1, 0, 1 } }
+    };
+
+#if defined( DEBUG_TRACE ) && GAIT_ENGINE == GAIT_ENGINE_SWITCHING
+    const char* const GAIT_NAMES[GAIT_COUNT] = { "Wave", "RippleGait", "Tripod" };
+#endif
+
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
+    // Gait transition graph, edges are grouped by the gait they leave.
+    // The edges of the current gait are checked in order and the first one whose condition holds
+    // is taken, the ascending and descending thresholds between two gaits give the hysteresis
+    enum Condition : uint8_t
+    {
+        // velocity > threshold
+        Faster,
+        // velocity < threshold
+        Slower,
+        // velocity <= threshold
+        Stopped
+    };
+
+    // Fields must be read with pgm_read_byte / pgm_read_float
+    struct GaitTransition
+    {
+        uint8_t from;
+        uint8_t to;
+        uint8_t condition;
+        // the edge is taken only after the gait ran for minGaitUptime
+        uint8_t afterUptime;
+        float threshold;
+    };
+
+    static constexpr GaitTransition TRANSITIONS[] PROGMEM = {
+        { Wave,   Tripod, Faster,  true,  tripodGaitOnAsc },
+        { Wave,   Ripple, Faster,  true,  rippleGaitOnAsc },
+        { Wave,   Idle,   Stopped, false, F_TOLERANCE },
+
+        { Ripple, Tripod, Faster,  true,  tripodGaitOnAsc },
+        { Ripple, Wave,   Slower,  true,  waveGaitOnDesc },
+        { Ripple, Idle,   Stopped, false, F_TOLERANCE },
+
+        { Tripod, Ripple, Slower,  true,  rippleGaitOnDesc },
+        { Tripod, Wave,   Slower,  true,  waveGaitOnDesc },
+        { Tripod, Idle,   Stopped, false, F_TOLERANCE },
+
+        { Idle,   Tripod, Faster,  false, tripodGaitOnAsc },
+        { Idle,   Ripple, Faster,  false, rippleGaitOnAsc },
+        { Idle,   Wave,   Faster,  false, waveGaitOnAsc }
+    };
+
+    static const int TRANSITION_COUNT = sizeof( TRANSITIONS ) / sizeof( TRANSITIONS[0] );
+
+    constexpr bool transitionsGrouped( int i )
+    {
+        return i + 1 >= TRANSITION_COUNT || ( TRANSITIONS[i].from <= TRANSITIONS[i + 1].from && transitionsGrouped( i + 1 ) );
+    }
+
+    static_assert( transitionsGrouped( 0 ), "TRANSITIONS must be sorted by the gait they leave" );
+
+    // index of the first edge leaving a gait
+    constexpr int firstTransition( int from, int i )
+    {
+        return i == TRANSITION_COUNT || TRANSITIONS[i].from >= from ? i : firstTransition( from, i + 1 );
+    }
+
+    struct TransitionIndexGenerator
+    {
+        typedef uint8_t Type;
+        // fixed gaits and idle
+        static const int SIZE = GAIT_COUNT + 1;
+
+        static constexpr Type value( int gait )
         {
-            Idle, 
-            Wave, 
-            Ripple, 
-            Tripod,
-            Mixer,
-
-            Total
-        };
-
-        SwitchingGait( Type type, float stanceSlope )
-            : m_type { type }
-            , m_stanceSlope { stanceSlope }
+            return firstTransition( gait, 0 );
+        }
+    };
+
+    typedef StaticTable< TransitionIndexGenerator > TransitionIndex;
+
+    // Velocities a gait keeps running at: no edge is taken while faster >= velocity >= slower and velocity > stopped,
+    // so a tick without transition costs three compares instead of the edge scan
+    struct TransitionBand
+    {
+        float faster;
+        float slower;
+        float stopped;
+    };
+
+    // tightest threshold of the edges of a condition leaving a gait, a condition without edges never holds
+    constexpr float edgeLimit( int from, int condition, bool afterUptime, int i )
+    {
+        return i == TRANSITION_COUNT ? ( condition == Faster ? FLT_MAX : -FLT_MAX ) :
+            TRANSITIONS[i].from != from || TRANSITIONS[i].condition != condition || ( TRANSITIONS[i].afterUptime && !afterUptime ) ?
+                edgeLimit( from, condition, afterUptime, i + 1 ) :
+            condition == Faster ?
+                const_min( TRANSITIONS[i].threshold, edgeLimit( from, condition, afterUptime, i + 1 ) ) :
+                const_max( TRANSITIONS[i].threshold, edgeLimit( from, condition, afterUptime, i + 1 ) );
+    }
+
+    struct TransitionBandGenerator
+    {
+        typedef TransitionBand Type;
+        // fixed gaits and idle, before and after minGaitUptime
+        static const int SIZE = ( GAIT_COUNT + 1 ) * 2;
+
+        static constexpr Type value( int i )
         {
-            if ( fabs(m_stanceSlope) > F_TOLERANCE )
-                m_speedMultiplier = 1 / m_stanceSlope;
+            return TransitionBand { edgeLimit( i / 2, Faster, i % 2, 0 ), edgeLimit( i / 2, Slower, i % 2, 0 ),
+                                    edgeLimit( i / 2, Stopped, i % 2, 0 ) };
         }
+    };
+
+    typedef StaticTable< TransitionBandGenerator > TransitionBands;
+#endif
+
+    constexpr double swingTime( const GaitDescriptor& gait )
+    {
+        return gait.period * ( 1 - gait.dutyFactor );
+    }
+
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
+    // Gait parameters read by the generic gait, fields must be read with pgm_read_float
+    struct GaitParameters
+    {
+        float period;
+        float swing;
+        float stanceSlope;
+        float offsets[NUM_LEGS];
+    };
+
+    struct ParameterGenerator
+    {
+        typedef GaitParameters Type;
+        static const int SIZE = GAIT_COUNT;
 
-        Type type() const
+        static constexpr GaitParameters value( int i )
         {
-            return m_type;
+            return GaitParameters {
+                float( GAITS[i].period ), float( swingTime( GAITS[i] ) ), float( GAITS[i].stanceSlope ),
+                { float( GAITS[i].offsets[0] ), float( GAITS[i].offsets[1] ), float( GAITS[i].offsets[2] ),
+                  float( GAITS[i].offsets[3] ), float( GAITS[i].offsets[4] ), float( GAITS[i].offsets[5] ) }
+            };
         }
+    };
+
+    typedef StaticTable< ParameterGenerator > GaitParameterTable;
+#endif
+
+#if GAIT_PHASE_TABLES
+    // Table values are positions on the step cycle as Q15 numbers: swing 0 -> 1, stance 1 -> 2.
+    // The position grows continuously and wraps with the uint16_t range, so interpolation
+    // never crosses the jumps of the phase ( -1 -> 0 at touch down, 1 -> 0 at lift off )
+    static const int CYCLE_SHIFT = 15;
+    static const uint16_t CYCLE_STANCE = 1U << CYCLE_SHIFT;
+    static const int FRACTION_SHIFT = 16;
+    // table of a gait, the table of leg i starts at i * GAIT_TABLE_SIZE
+    static const int GAIT_TABLE_LENGTH = NUM_LEGS * GAIT_TABLE_SIZE;
+
+    // position on the cycle at t = [0; period)
+    constexpr double cyclePositionReduced( double swing, double period, double t )
+    {
+        return t < swing ? t / swing : 1 + ( t - swing ) / ( period - swing );
+    }
+
+    // t >= 0 is reduced to the period
+    constexpr double cyclePositionAt( double swing, double period, double t )
+    {
+        return cyclePositionReduced( swing, period, t - period * long( t / period ) );
+    }
 
-        SwitchingGait* input( float velocity, float t )
+    // position on the cycle of a leg at table sample index, fractional indices are between samples
+    constexpr double cyclePosition( int gait, int leg, double index )
+    {
+        return cyclePositionAt( swingTime( GAITS[gait] ), GAITS[gait].period,
+                                index * GAITS[gait].period / GAIT_TABLE_SIZE + GAITS[gait].offsets[leg] );
+    }
+
+    // tables of all gaits in GAITS order
+    struct PhaseGenerator
+    {
+        typedef uint16_t Type;
+        static const int SIZE = GAIT_COUNT * GAIT_TABLE_LENGTH;
+
+        static constexpr Type value( int index )
         {
-            m_uptime = t - m_t;
-            return onInput( velocity, t );
+            // a position rounded up to 2 wraps to 0
+            return Type( const_round( cyclePosition( index / GAIT_TABLE_LENGTH, index / GAIT_TABLE_SIZE % NUM_LEGS,
+                                                     index % GAIT_TABLE_SIZE ) * CYCLE_STANCE ) );
         }
+    };
+
+    typedef StaticTable< PhaseGenerator > PhaseTable;
+
+    // Error estimation: interpolation error is max at interval centers and at the
+    // swing / stance corners, distances are measured along the cycle
+
+    constexpr double cycleDistance( double a, double b )
+    {
+        return const_min( const_abs( a - b ), 2 - const_abs( a - b ) );
+    }
+
+    constexpr double tableValue( double value )
+    {
+        return value / CYCLE_STANCE;
+    }
+
+    constexpr double interpolateCycle( double v0, double v1, double fraction )
+    {
+        return v0 + ( v1 >= v0 ? v1 - v0 : v1 + 2 - v0 ) * fraction;
+    }
+
+    // first entry of the table of a leg
+    constexpr int tableStart( int gait, int leg )
+    {
+        return gait * GAIT_TABLE_LENGTH + leg * GAIT_TABLE_SIZE;
+    }
+
+    constexpr double tableError( int gait, int leg, double index )
+    {
+        return cycleDistance( interpolateCycle( tableValue( PhaseGenerator::value( tableStart( gait, leg ) + int( index ) ) ),
+                                                tableValue( PhaseGenerator::value( tableStart( gait, leg ) + ( int( index ) + 1 ) % GAIT_TABLE_SIZE ) ),
+                                                index - int( index ) ),
+                              cyclePosition( gait, leg, index ) );
+    }
+
+    // table index of a cycle time of a leg
+    constexpr double cornerIndex( int gait, int leg, double t )
+    {
+        return ( t - GAITS[gait].offsets[leg] + GAITS[gait].period ) * GAIT_TABLE_SIZE / GAITS[gait].period -
+            GAIT_TABLE_SIZE * long( ( t - GAITS[gait].offsets[leg] + GAITS[gait].period ) / GAITS[gait].period );
+    }
+
+    constexpr double legError( int gait, int leg )
+    {
+        return const_max( tableError( gait, leg, cornerIndex( gait, leg, 0 ) ),
+                          tableError( gait, leg, cornerIndex( gait, leg, swingTime( GAITS[gait] ) ) ) );
+    }
+
+    constexpr double entryError( int gait, int leg, int index )
+    {
+        return const_max( tableError( gait, leg, index + 0.5 ), index == 0 ? legError( gait, leg ) : 0 );
+    }
+
+    // splits the range in halves to keep constexpr recursion shallow
+    constexpr double maxError( int first, int last )
+    {
+        return last - first == 1 ?
+            entryError( first / GAIT_TABLE_LENGTH, first / GAIT_TABLE_SIZE % NUM_LEGS, first % GAIT_TABLE_SIZE ) :
+            const_max( maxError( first, ( first + last ) / 2 ), maxError( ( first + last ) / 2, last ) );
+    }
+
+    static constexpr double GAIT_TABLE_ERROR = maxError( 0, PhaseGenerator::SIZE );
+
+    static_assert( GAIT_TABLE_ERROR <= GAIT_TABLE_MAX_ERROR, "GAIT_TABLE_SIZE is too small for GAIT_TABLE_MAX_ERROR" );
+
+    // table sample of a gait time, shared by all legs
+    struct TableSample
+    {
+        uint8_t index;
+        uint16_t fraction;
+    };
+
+    TableSample tableSample( float t, float frequency )
+    {
+        float cycles = t * frequency;
+        cycles -= ( long ) cycles;
+        if( cycles < 0 )
+            cycles += 1.0f;
+
+        float position = cycles * GAIT_TABLE_SIZE;
+        TableSample sample;
+        sample.index = ( uint8_t ) position;
+        sample.fraction = ( uint16_t ) ( ( position - sample.index ) * ( 1L << FRACTION_SHIFT ) );
+        if( sample.index >= GAIT_TABLE_SIZE )
+        {
+            // cycles rounded up to 1
+            sample.index = 0;
+            sample.fraction = 0;
+        }
+        return sample;
+    }
+
+    float tablePhase( const uint16_t* table, int legIndex, const TableSample& sample )
+    {
+        table += legIndex * GAIT_TABLE_SIZE;
+        uint16_t v0 = pgm_read_word( &table[sample.index] );
+        uint16_t v1 = pgm_read_word( &table[sample.index + 1 < GAIT_TABLE_SIZE ? sample.index + 1 : 0] );
+        // the difference is taken modulo the cycle, it is positive across the wrap
+        uint16_t position = v0 + ( uint16_t ) ( ( ( uint32_t ) ( uint16_t ) ( v1 - v0 ) * sample.fraction ) >> FRACTION_SHIFT );
+
+        static const float CYCLE_SCALE = 1.0f / CYCLE_STANCE;
+        return position < CYCLE_STANCE ? -( position * CYCLE_SCALE ) : ( position - CYCLE_STANCE ) * CYCLE_SCALE;
+    }
+#endif
+
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
+    class SwitchingGait : public Gait
+    {
+    public:
+        SwitchingGait( uint8_t id, float stanceSlope )
+            : m_id { id }
+        {
+            setStanceSlope( stanceSlope );
+        }
+
+        uint8_t id() const
+        {
+            return m_id;
+        }
+
+        // gait time of this tick, returns the gait of the next tick
+        SwitchingGait* input( float velocity, float t );
 
         float getStanceSlope() const
         {
@@ -64,12 +396,6 @@ namespace
 #ifdef DEBUG_TRACE
         virtual const char* name() const = 0;
 #endif   
-        float clamp( int leg, float t ) const
-        {
-            double intP {};
-            return modf( (t + m_offsets[leg]) / m_period, &intP ) * m_period;
-        }
-
         void start( float t )
         {
             m_t = t;
@@ -81,11 +407,20 @@ namespace
             return m_uptime;
         }
 
+    protected:
+        void setStanceSlope( float stanceSlope )
+        {
+            m_stanceSlope = stanceSlope;
+            if ( fabs(m_stanceSlope) > F_TOLERANCE )
+                m_speedMultiplier = 1 / m_stanceSlope;
+        }
+
     private:
-        virtual SwitchingGait* onInput( float velocity, float t ) = 0;
+        // edges of the transition graph
+        SwitchingGait* transition( float velocity, float t );
 
         float m_stanceSlope {};
-        Type m_type;
+        uint8_t m_id;
 
         float m_t {};
         float m_uptime {};
@@ -103,10 +438,10 @@ namespace
         }
 #endif 
         void setup( SwitchingGait* from, SwitchingGait* to, float t, float period = minGaitUptime );
+        SwitchingGait* next();
 
     private:
         float onEval( int legIndex, float t ) const override;
-        SwitchingGait* onInput( float velocity, float t ) override;
 
         Curve m_curves[NUM_LEGS];
         SwitchingGait* m_to {};
@@ -124,65 +459,42 @@ namespace
 
     private:
         float onEval( int legIndex, float t ) const override;
-        SwitchingGait* onInput( float velocity, float t ) override;
 
         float m_phazes[NUM_LEGS] {};
     };
 
-    class WaveGait : public SwitchingGait
+    // Gait of a descriptor of GAITS
+    class FixedGait : public SwitchingGait
     {
     public:
-        WaveGait();        
+        FixedGait( uint8_t id );
 
     private:
         float onEval( int legIndex, float t ) const override;
-        SwitchingGait* onInput( float velocity, float t ) override;
-
 #ifdef DEBUG_TRACE
-        const char* name() const override { return "Wave"; }
+        const char* name() const override { return GAIT_NAMES[id()]; }
 #endif 
-    };
-
-    class RippleGait : public SwitchingGait
-    {
-    public:
-        RippleGait();
-
-    private:
-        float onEval( int legIndex, float t ) const override;
-        SwitchingGait* onInput( float velocity, float t ) override;
-
-#ifdef DEBUG_TRACE
-        const char* name() const override { return "RippleGait"; }
-#endif 
-    };
-
-    class TripodGait : public SwitchingGait
-    {
-    public:
-        TripodGait();
+        float clamp( int leg, float t ) const
+        {
+            double intP {};
+            return modf( (t + m_offsets[leg]) / m_period, &intP ) * m_period;
+        }
 
-    private:
-        float onEval( int legIndex, float t ) const override;
-        SwitchingGait* onInput( float velocity, float t ) override;
-#ifdef DEBUG_TRACE
-        const char* name() const override { return "Tripod"; }
-#endif 
+        float m_swing {};
     };     
 
-    SwitchingGait* gait( SwitchingGait::Type type )
+    SwitchingGait* gait( uint8_t id )
     {
         static SwitchingGait** s_gaits = nullptr;
         if( !s_gaits )
         {
-            s_gaits = new SwitchingGait*[SwitchingGait::Total];
-            s_gaits[SwitchingGait::Idle] = nullptr;
-            s_gaits[SwitchingGait::Wave] = new WaveGait;
-            s_gaits[SwitchingGait::Ripple] = new RippleGait;
-            s_gaits[SwitchingGait::Tripod] = new TripodGait;
-            s_gaits[SwitchingGait::Mixer] = nullptr;
+            s_gaits = new SwitchingGait*[GAIT_COUNT];
+            for( uint8_t i = 0; i < GAIT_COUNT; ++i )
+            {
+                s_gaits[i] = new FixedGait( i );
+            }
         }
-        return s_gaits[type];
+        return s_gaits[id];
     }
 
     SwitchingGait* idle( SwitchingGait* prev, float t )
@@ -215,13 +527,166 @@ namespace
         return to ? to : idle( from, t );
 #endif
     }    
+#endif
+
+#if GAIT_ENGINE == GAIT_ENGINE_CPG
+    // Velocities at which the oscillators settle into the pattern of a fixed gait, the patterns are
+    // interpolated in between, across the hysteresis bands of the switching engine
+    struct CpgKeyframe
+    {
+        float velocity;
+        uint8_t gait;
+    };
+
+    static constexpr CpgKeyframe CPG_KEYFRAMES[] = {
+        { waveGaitOnDesc,   Wave },
+        { rippleGaitOnAsc,  Ripple },
+        { rippleGaitOnDesc, Ripple },
+        { tripodGaitOnAsc,  Tripod }
+    };
+
+    static const int CPG_KEYFRAME_COUNT = sizeof( CPG_KEYFRAMES ) / sizeof( CPG_KEYFRAMES[0] );
 
+    // part of the cycle a leg leads leg 0
+    constexpr double legLead( int gait, int leg )
+    {
+        return GAITS[gait].offsets[leg] / GAITS[gait].period;
+    }
+
+    // leads are unwrapped against the previous keyframe so they interpolate along the shorter way
+    constexpr double keyframeLead( int key, int leg )
+    {
+        return key == 0 ? legLead( CPG_KEYFRAMES[0].gait, leg ) :
+            legLead( CPG_KEYFRAMES[key].gait, leg ) +
+            const_round( keyframeLead( key - 1, leg ) - legLead( CPG_KEYFRAMES[key].gait, leg ) );
+    }
+
+    // Oscillator pattern at a keyframe velocity, fields must be read with pgm_read_float
+    struct CpgPattern
+    {
+        float velocity;
+        float swing;
+        // cycles per gait time unit, stance runs as fast as in the fixed gait
+        float frequency;
+        float leads[NUM_LEGS];
+    };
+
+    struct CpgPatternGenerator
+    {
+        typedef CpgPattern Type;
+        static const int SIZE = CPG_KEYFRAME_COUNT;
+
+        static constexpr CpgPattern value( int key )
+        {
+            return CpgPattern {
+                CPG_KEYFRAMES[key].velocity, float( 1 - GAITS[CPG_KEYFRAMES[key].gait].dutyFactor ),
+                float( 1 / ( GAITS[CPG_KEYFRAMES[key].gait].stanceSlope * GAITS[CPG_KEYFRAMES[key].gait].period ) ),
+                { float( keyframeLead( key, 0 ) ), float( keyframeLead( key, 1 ) ), float( keyframeLead( key, 2 ) ),
+                  float( keyframeLead( key, 3 ) ), float( keyframeLead( key, 4 ) ), float( keyframeLead( key, 5 ) ) }
+            };
+        }
+    };
+
+    typedef StaticTable< CpgPatternGenerator > CpgPatternTable;
+
+    // cycle difference to [-0.5; 0.5)
+    float wrapCycle( float d )
+    {
+        return d - floor( d + 0.5f );
+    }
+
+    // Six phase oscillators coupled towards the leads of the pattern of the commanded velocity.
+    // Gait time runs one cycle per unit, the speed multiplier keeps the stance speed of the fixed gaits.
+    // Each oscillator is pulled linearly towards the mean phase error of all legs. Sine coupling would
+    // stall when the pattern jumps, tripod errors against the wave leads cancel out on the circle
+    class CpgGait : public Gait
+    {
+    public:
+        CpgGait();
+
+        // integrates the oscillators up to gait time t
+        void input( float velocity, float t );
+
+    private:
+        float onEval( int legIndex, float t ) const override;
+        void setPattern( float velocity );
+        // position on the cycle of a leg at gait time t, swing 0 -> swing, stance swing -> 1
+        float cycle( int legIndex, float t ) const;
+
+        // pattern of the commanded velocity
+        float m_patternSwing {};
+        float m_leads[NUM_LEGS] {};
+
+        // oscillator state at m_t, cycle positions [0; 1)
+        float m_cycles[NUM_LEGS] {};
+        float m_rates[NUM_LEGS] {};
+        // swing part of each leg, latched at lift off so a leg never flips between swing and stance mid step
+        float m_swing[NUM_LEGS] {};
+        float m_t {};
+    };
+#endif
+
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
     SwitchingGait* s_currentGait = idle( nullptr, 0.0 );
+#endif
+}
+
+#if GAIT_ENGINE == GAIT_ENGINE_SWITCHING
+SwitchingGait* SwitchingGait::input( float velocity, float t )
+{
+    m_uptime = t - m_t;
+#if USE_GAIT_MIXER
+    if( m_id == Mixer )
+        return static_cast< GaitMixer* >( this )->next();
+#endif
+    return transition( velocity, t );
+}
+
+SwitchingGait* SwitchingGait::transition( float velocity, float t )
+{
+    bool afterUptime = uptime() > minGaitUptime;
+    const auto& band = TransitionBands::data[m_id * 2 + afterUptime];
+    if( velocity <= pgm_read_float( &band.faster ) && velocity >= pgm_read_float( &band.slower ) &&
+        velocity > pgm_read_float( &band.stopped ) )
+        return this;
+
+    for( int i = pgm_read_byte( &TransitionIndex::data[m_id] ); i < TRANSITION_COUNT; ++i )
+    {
+        const auto& edge = TRANSITIONS[i];
+        if( pgm_read_byte( &edge.from ) != m_id )
+            break;
+
+        if( pgm_read_byte( &edge.afterUptime ) && !afterUptime )
+            continue;
+
+        float threshold = pgm_read_float( &edge.threshold );
+        bool taken = false;
+        switch( pgm_read_byte( &edge.condition ) )
+        {
+        case Faster:
+            taken = velocity > threshold;
+            break;
+        case Slower:
+            taken = velocity < threshold;
+            break;
+        case Stopped:
+            taken = velocity <= threshold;
+            break;
+        }
+
+        if( taken )
+        {
+            uint8_t to = pgm_read_byte( &edge.to );
+            return mix( this, to == Idle ? nullptr : gait( to ), t );
+        }
+    }
+
+    return this;
 }
 
 #if USE_GAIT_MIXER
 GaitMixer::GaitMixer()
-    : SwitchingGait( Type::Mixer, 1.0f )
+    : SwitchingGait( Mixer, 1.0f )
 {
 }
 
@@ -375,7 +840,7 @@ float GaitMixer::onEval( int legIndex, float t ) const
     return phaze;
 }
 
-SwitchingGait* GaitMixer::onInput( float velocity, float t )
+SwitchingGait* GaitMixer::next()
 {
     if( uptime() > m_period )
         return m_to;
@@ -386,7 +851,7 @@ SwitchingGait* GaitMixer::onInput( float velocity, float t )
 #endif
 
 IdleGait::IdleGait()
-    : SwitchingGait( Type::Idle, 0.0f )
+    : SwitchingGait( Idle, 0.0f )
 {
 }
 
@@ -410,125 +875,113 @@ float IdleGait::onEval( int legIndex, float t ) const
     return m_phazes[legIndex];
 }
 
-SwitchingGait* IdleGait::onInput( float velocity, float t )
-{
-    if( velocity > tripodGaitOnAsc )
-        return mix( this, gait( SwitchingGait::Tripod ), t );
-
-    if( velocity > rippleGaitOnAsc )
-        return mix( this, gait( SwitchingGait::Ripple ), t );
-
-    if( velocity > waveGaitOnAsc )
-        return mix( this, gait( SwitchingGait::Wave ), t );
-
-    return this;
-}
-
-
-WaveGait::WaveGait()
-    : SwitchingGait( Type::Wave, 0.2f )
+FixedGait::FixedGait( uint8_t id )
+    : SwitchingGait( id, pgm_read_float( &GaitParameterTable::data[id].stanceSlope ) )
 {
-    m_period = 6.0;
-    m_offsets[0] = 0.0f;
-    m_offsets[1] = 1.0f;
-    m_offsets[2] = 2.0f;
-    m_offsets[3] = 3.0f;
-    m_offsets[4] = 4.0f;
-    m_offsets[5] = 5.0f;
+    const auto& parameters = GaitParameterTable::data[id];
+    m_period = pgm_read_float( &parameters.period );
+    m_swing = pgm_read_float( &parameters.swing );
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        m_offsets[i] = pgm_read_float( &parameters.offsets[i] );
+    }
+#if GAIT_PHASE_TABLES
+    m_phaseTable = &PhaseTable::data[id * GAIT_TABLE_LENGTH];
+    m_frequency = 1.0f / m_period;
+#endif
 }
 
-float WaveGait::onEval( int legIndex, float t ) const
+float FixedGait::onEval( int legIndex, float t ) const
 {
     t = clamp( legIndex, t );
-    return t < 1.0f ? -t : ( ( t - 1.0f ) / 5.0f );
+    return t < m_swing ? -t / m_swing : ( t - m_swing ) / ( m_period - m_swing );
 }
+#endif
 
-SwitchingGait* WaveGait::onInput( float velocity, float t )
+#if GAIT_ENGINE == GAIT_ENGINE_CPG
+CpgGait::CpgGait()
 {
-    if( uptime() > minGaitUptime )
+    setPattern( 0.0f );
+    // stand in the middle of the stance like the idle gait, the coupling spreads the legs once moving
+    for( int i = 0; i < NUM_LEGS; ++i )
     {
-        if( velocity > tripodGaitOnAsc )
-            return mix( this, gait( SwitchingGait::Tripod ), t );
-
-        if( velocity > rippleGaitOnAsc )
-            return mix( this, gait( SwitchingGait::Ripple ), t );
+        m_swing[i] = m_patternSwing;
+        m_cycles[i] = ( 1 + m_swing[i] ) * 0.5f;
     }
-
-    if( velocity <= F_TOLERANCE )
-        return mix( this, nullptr, t );
-
-    return this;
 }
 
-RippleGait::RippleGait()
-    : SwitchingGait( Type::Ripple, 0.25f )
+void CpgGait::setPattern( float velocity )
 {
-    m_period = 6.0f;
-    m_offsets[0] = 0.0f;
-    m_offsets[1] = 2.0f;
-    m_offsets[2] = 4.0f;
-    m_offsets[3] = 1.0f;
-    m_offsets[4] = 3.0f;
-    m_offsets[5] = 5.0f;
+    int key = 0;
+    while( key < CPG_KEYFRAME_COUNT - 1 && velocity > pgm_read_float( &CpgPatternTable::data[key + 1].velocity ) )
+        ++key;
+
+    const auto& p0 = CpgPatternTable::data[key];
+    const auto& p1 = CpgPatternTable::data[min( key + 1, CPG_KEYFRAME_COUNT - 1 )];
+    float v0 = pgm_read_float( &p0.velocity );
+    float v1 = pgm_read_float( &p1.velocity );
+    float f = v1 > v0 ? constrain( ( velocity - v0 ) / ( v1 - v0 ), 0.0f, 1.0f ) : 0.0f;
+
+    m_patternSwing = lerp( pgm_read_float( &p0.swing ), pgm_read_float( &p1.swing ), f );
+    m_speedMultiplier = lerp( pgm_read_float( &p0.frequency ), pgm_read_float( &p1.frequency ), f );
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        m_leads[i] = lerp( pgm_read_float( &p0.leads[i] ), pgm_read_float( &p1.leads[i] ), f );
+    }
 }
 
-float RippleGait::onEval( int legIndex, float t ) const
+void CpgGait::input( float velocity, float t )
 {
-    t = clamp( legIndex, t );
-    return t < 2.0f ? ( -t / 2.0f ) : ( ( t - 2.0f ) / 4.0f );
-}
+    // limits the step when gait time jumps
+    float dt = constrain( t - m_t, 0.0f, 0.25f );
+    m_t = t;
 
-SwitchingGait* RippleGait::onInput( float velocity, float t )
-{
-    if( uptime() > minGaitUptime )
-    {
-        if( velocity > tripodGaitOnAsc )
-            return mix( this, gait( SwitchingGait::Tripod ), t );
+    setPattern( velocity );
 
-        if( velocity < waveGaitOnDesc )
-            return mix( this, gait( SwitchingGait::Wave ), t );
+    // mean of the phase errors, offsets from leg 0 are wrapped to [-0.5; 0.5) so it is defined for any spread
+    float errors[NUM_LEGS];
+    float mean = 0.0f;
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        errors[i] = m_cycles[i] - m_leads[i];
+        mean += wrapCycle( errors[i] - errors[0] );
     }
+    mean = errors[0] + mean / NUM_LEGS;
 
-    if( velocity <= F_TOLERANCE )
-        return mix( this, nullptr, t );
+    bool moving = velocity > F_TOLERANCE;
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        if( moving )
+            m_rates[i] = constrain( 1.0f + float( CPG_COUPLING ) * wrapCycle( mean - errors[i] ), 0.0f, float( CPG_RATE_MAX ) );
+        else
+            // stopped: legs in the air finish their swing, legs on the ground hold
+            m_rates[i] = m_cycles[i] < m_swing[i] ? 1.0f : 0.0f;
 
-    return this;
+        float cycle = m_cycles[i] + m_rates[i] * dt;
+        if( cycle >= 1.0f )
+        {
+            // lift off
+            cycle -= 1.0f;
+            m_swing[i] = m_patternSwing;
+        }
+        m_cycles[i] = cycle;
+    }
 }
 
-TripodGait::TripodGait()
-    : SwitchingGait( Type::Tripod, 0.75f )
+float CpgGait::cycle( int legIndex, float t ) const
 {
-    m_period = 2.0f;
-    m_offsets[0] = 0.0f;
-    m_offsets[1] = 1.0f;
-    m_offsets[2] = 0.0f;
-    m_offsets[3] = 1.0f;
-    m_offsets[4] = 0.0f;
-    m_offsets[5] = 1.0f;
+    // free running from the last step, Mover evaluates the time it advanced after query
+    float cycle = m_cycles[legIndex] + m_rates[legIndex] * max( t - m_t, 0.0f );
+    return cycle - ( long ) cycle;
 }
 
-float TripodGait::onEval( int legIndex, float t ) const
+float CpgGait::onEval( int legIndex, float t ) const
 {
-    t = clamp( legIndex, t );
-    return t < 1.0f ? -t : t - 1.0f;
-}
-
-SwitchingGait* TripodGait::onInput( float velocity, float t )
-{
-    if( uptime() > minGaitUptime )
-    {
-        if( velocity < rippleGaitOnDesc )
-            return mix( this, gait( SwitchingGait::Ripple ), t );
-
-        if( velocity < waveGaitOnDesc )
-            return mix( this, gait( SwitchingGait::Wave ), t );
-    }
-
-    if( velocity <= F_TOLERANCE )
-        return mix( this, nullptr, t );
-
-    return this;
+    float swing = m_swing[legIndex];
+    float cycle = this->cycle( legIndex, t );
+    return cycle < swing ? -cycle / swing : ( cycle - swing ) / ( 1 - swing );
 }
+#endif
 
 Gait::Gait()
 {
@@ -536,11 +989,40 @@ Gait::Gait()
 
 float Gait::evaluate( int legIndex, float t ) const
 {
+#if GAIT_PHASE_TABLES
+    if( m_phaseTable )
+        return tablePhase( m_phaseTable, legIndex, tableSample( t, m_frequency ) );
+#endif
     return onEval( legIndex, t );
 }
 
+void Gait::evaluate( float t, float phases[NUM_LEGS] ) const
+{
+#if GAIT_PHASE_TABLES
+    if( m_phaseTable )
+    {
+        // legs share the sample, their offsets are in the tables
+        auto sample = tableSample( t, m_frequency );
+        for( int i = 0; i < NUM_LEGS; ++i )
+        {
+            phases[i] = tablePhase( m_phaseTable, i, sample );
+        }
+        return;
+    }
+#endif
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        phases[i] = onEval( i, t );
+    }
+}
+
 const Gait* const Gait::query( float velocity, float t )
 {
+#if GAIT_ENGINE == GAIT_ENGINE_CPG
+    static CpgGait s_cpg;
+    s_cpg.input( velocity, t );
+    return &s_cpg;
+#else
     auto next = s_currentGait->input( velocity, t );
 
     if( next != s_currentGait )
@@ -555,4 +1037,5 @@ const Gait* const Gait::query( float velocity, float t )
     }
 
     return s_currentGait;
-}
\ No newline at end of file
+#endif
+}
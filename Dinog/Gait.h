@@ -2,6 +2,24 @@
 
 #include "Common.h"
 
+#include <stdint.h>
+
+// Fixed gaits ( wave, ripple, tripod ) are evaluated from per leg phase tables generated at
+// compile time, an index and a linear interpolation instead of a virtual call, a divide and modf per leg
+#define GAIT_PHASE_TABLES 1
+
+// Gait engines returned by Gait::query:
+// SWITCHING - fixed gaits switched through the velocity transition graph and blended by the gait mixer
+// CPG       - six coupled phase oscillators, their phase offsets and duty factor follow the velocity
+//             continuously, so no leg jumps at a transition.  It settles into the new gait more slowly
+//             than the switching engine and costs about twice as much per tick, see Host/CpgBench.cpp
+#define GAIT_ENGINE_SWITCHING 0
+#define GAIT_ENGINE_CPG       1
+
+#ifndef GAIT_ENGINE
+#define GAIT_ENGINE GAIT_ENGINE_SWITCHING
+#endif
+
 class Gait
 {
 public:
@@ -11,6 +29,8 @@ public:
     // phase < 0 - swing 
     // phase > 0 - stance
     float evaluate( int legIndex, float t ) const;
+    // evaluates phases of all legs
+    void evaluate( float t, float phases[NUM_LEGS] ) const;
     float getSpeedMultiplier() const
     {
         return m_speedMultiplier;
@@ -29,4 +49,9 @@ protected:
     float m_period { 1.0f };
     float m_offsets[NUM_LEGS] {};
     float m_speedMultiplier {1.0f};
+#if GAIT_PHASE_TABLES
+    // PROGMEM, GAIT_TABLE_SIZE samples per leg over one period, nullptr evaluates onEval
+    const uint16_t* m_phaseTable {};
+    float m_frequency {};
+#endif
 };
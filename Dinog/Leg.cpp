@@ -1,10 +1,52 @@
 #include "Leg.h"
 #include "Common.h"
+#include "LegGeometry.h"
+#include "SerialServos.h"
 
 #include <MathUtils.h>
+#include <FixedPoint.h>
+#include <ConstMath.h>
+#include <StaticTable.h>
 #include <Arduino.h>
 #include <EEPROM.h>
 
+// IK kernel implementations
+#define IK_KERNEL_FLOAT         0
+// Q-format fixed point (see evaluate() below for the error bound),
+// integer servo values match the float kernel or differ by 1 on rounding boundary
+#define IK_KERNEL_FIXED_POINT   1
+// PROGMEM lookup tables with linear interpolation generated at compile time
+#define IK_KERNEL_TABLE         2
+
+#ifndef IK_KERNEL
+#define IK_KERNEL IK_KERNEL_FLOAT
+#endif
+
+// Lookup table step is 2^IK_TABLE_STEP_SHIFT squared millimeters of L4^2, trades flash for accuracy
+// (2 tables of int16_t): 8 - 66 entries, 0.14 deg, 7 - 131, 0.05 deg, 6 - 261, 0.018 deg, 5 - 521, 0.012 deg
+#ifndef IK_TABLE_STEP_SHIFT
+#define IK_TABLE_STEP_SHIFT 7
+#endif
+// atan table has 2^IK_ATAN_TABLE_SHIFT intervals on [0; 1]
+#define IK_ATAN_TABLE_SHIFT 5
+// Compilation fails if the estimated max table error exceeds this bound, degrees
+#define IK_TABLE_MAX_ERROR 0.1
+
+// Float kernel uses fast_* approximations from MathUtils (see FAST_MATH_PRECISION), the joint angles
+// stay within 0.6 deg of libm at LOW, 0.01 deg at MEDIUM and 0.001 deg at HIGH (see Host/IkFloatTest.cpp)
+#ifndef USE_FAST_MATH
+#define USE_FAST_MATH 0
+#endif
+// Float kernel writes joint angles to the servos as timer ticks through per servo
+// linear calibration instead of integer degrees
+#ifndef USE_SERVO_TICKS
+#define USE_SERVO_TICKS 1
+#endif
+
+#if IK_INCREMENTAL && IK_KERNEL != IK_KERNEL_FLOAT
+#error Incremental IK requires the float kernel
+#endif
+
 namespace
 {
     static const int EEPROM_trimsOffset = 0;
@@ -21,48 +63,662 @@ namespace
 
     bool transaction = false;
 
-    void evaluate( const Vec3f& pos, const Leg::Config& legConfig, int& coxaValue, int& femurValue, int& tibiaValue )
+    // Reachable workspace: coxa angle limit, then a polar box around the femur joint.
+    // Distance to the femur joint ( L4 ) follows from the tibia joint limits,
+    // elevation of the L4 line keeps the foot in front of the femur joint
+    static constexpr double COXA_LIMIT = const_radians( 80 );
+    static constexpr double TIBIA_MIN = const_radians( 10 );
+    static constexpr double TIBIA_MAX = const_radians( 170 );
+    static constexpr double ELEVATION_LIMIT = const_radians( 75 );
+
+    static constexpr float COS_COXA_LIMIT = const_cos( COXA_LIMIT );
+    static constexpr float SIN_COXA_LIMIT = const_sin( COXA_LIMIT );
+    static constexpr float TAN_COXA_LIMIT = const_sin( COXA_LIMIT ) / const_cos( COXA_LIMIT );
+    static constexpr float TAN_ELEVATION_LIMIT = const_sin( ELEVATION_LIMIT ) / const_cos( ELEVATION_LIMIT );
+    // L4^2 = L2^2 + L3^2 + 2 * L2 * L3 * cos( tibia )
+    static constexpr float L4_2_MAX = L2_2 + L3_2 + 2.0 * Leg::Config::L2 * Leg::Config::L3 * const_cos( TIBIA_MIN );
+    static constexpr float L4_2_MIN = L2_2 + L3_2 + 2.0 * Leg::Config::L2 * Leg::Config::L3 * const_cos( TIBIA_MAX );
+    static constexpr float L4_MAX = const_sqrt( L4_2_MAX );
+    static constexpr float L4_MIN = const_sqrt( L4_2_MIN );
+
+    // projects pos onto the reachable workspace, returns true if it was moved
+    bool clampToWorkspace( Vec3f& pos )
     {
-        auto Px_2 = pos[0] * pos[0];
-        auto Py_2 = pos[1] * pos[1];
-        auto Pz_2 = pos[2] * pos[2];
+        bool saturated = false;
+        auto x = pos[0];
+        auto y = pos[1];
+        auto z = pos[2];
+        auto P0 = sqrt( x * x + y * y );
 
-        auto P0 = sqrt( Px_2 + Py_2 );
-        auto L4_2 = ( P0 - Leg::Config::L1 ) * ( P0 - Leg::Config::L1 ) + Pz_2;
-        auto L4 = sqrt( L4_2 );
+        // also catches the leg behind the coxa joint ( x <= 0 )
+        if( fabs( y ) > x * TAN_COXA_LIMIT )
+        {
+            x = P0 * COS_COXA_LIMIT;
+            y = y < 0 ? -P0 * SIN_COXA_LIMIT : P0 * SIN_COXA_LIMIT;
+            saturated = true;
+        }
+
+        auto D = P0 - Leg::Config::L1;
+        auto L4_2 = D * D + z * z;
+        if( L4_2 > L4_2_MAX || L4_2 < L4_2_MIN || fabs( z ) > D * TAN_ELEVATION_LIMIT )
+        {
+            // constraints are independent in polar coordinates, so one pass is enough
+            auto L4 = constrain( sqrt( L4_2 ), L4_MIN, L4_MAX );
+            auto elevation = constrain( atan2( z, D ), -ELEVATION_LIMIT, ELEVATION_LIMIT );
+            D = L4 * cos( elevation );
+            z = L4 * sin( elevation );
+
+            auto P = D + Leg::Config::L1;
+            if( P0 > 0 )
+            {
+                x *= P / P0;
+                y *= P / P0;
+            }
+            else
+            {
+                x = P;
+                y = 0;
+            }
+            saturated = true;
+        }
+
+        if( saturated )
+            pos.set( x, y, z );
+        return saturated;
+    }
+
+    // trims are loaded from EEPROM, geometry is in LegGeometry.h
+    Leg::Config s_config[NUM_LEGS] = {
+        { 93, 100, 3 },
+        { 93, 100, 3 },
+        { 93, 100, 3 },
+        { 93, 100, 3 },
+        { 93, 100, 3 },
+        { 93, 100, 3 }
+    };
+
+#if IK_KERNEL != IK_KERNEL_FLOAT
+    // lengths are Q7 millimeters, squared lengths are Q14
+    // coordinates are limited, so all squares fit into 32 bits
+    static const int FX_LENGTH_SHIFT = 7;
+    static const float FX_MAX_COORD = 180.0f;
+    static const int32_t L1_FX = ( int32_t ) Leg::Config::L1 << FX_LENGTH_SHIFT;
+
+    int32_t toFixed( float v )
+    {
+        v = constrain( v, -FX_MAX_COORD, FX_MAX_COORD );
+        return lround( v * ( 1 << FX_LENGTH_SHIFT ) );
+    }
+#endif
+
+#if IK_KERNEL == IK_KERNEL_FIXED_POINT
+    static const int32_t L2_FX = ( int32_t ) Leg::Config::L2 << FX_LENGTH_SHIFT;
+    static const int32_t L3_FX = ( int32_t ) Leg::Config::L3 << FX_LENGTH_SHIFT;
+    static const int32_t L2_2_FX = L2_FX * L2_FX;
+    static const int32_t L3_2_FX = L3_FX * L3_FX;
+    static const int32_t L4_2_MAX_FX = ( L2_FX + L3_FX ) * ( L2_FX + L3_FX );
+    static const int32_t L4_2_MIN_FX = ( L3_FX - L2_FX ) * ( L3_FX - L2_FX );
+
+    // atan( y / x ) keeping the float kernel branch for negative x
+    int32_t atan_fx( int32_t y, int32_t x )
+    {
+        return x < 0 ? atan2_fx( -y, -x ) : atan2_fx( y, x );
+    }
+
+    // Q16.16 joint angles before inversion and trims
+    // Max deviation from the float kernel ( Host/IkKernelTest, sweep of the leg workspace ):
+    //  coxa - 0.01 deg
+    //  femur, tibia - 0.06 deg while |cos| of the knee triangle angles <= 0.99,
+    //                 0.17 deg while <= 0.999, it grows near fully stretched/folded leg
+    void solve( const Vec3f& pos, int32_t& coxa, int32_t& femur, int32_t& tibia )
+    {
+        auto Px = toFixed( pos[0] );
+        auto Py = toFixed( pos[1] );
+        auto Pz = toFixed( pos[2] );
+
+        auto P0 = ( int32_t ) isqrt32( Px * Px + Py * Py );
+        auto D = P0 - L1_FX;
+        auto L4_2 = D * D + Pz * Pz;
+        L4_2 = constrain( L4_2, L4_2_MIN_FX, L4_2_MAX_FX );
+
+        // acos of the law of cosines is evaluated as atan2( 4 * area, 2 * a * b * cos ),
+        // 16 * area^2 is expressed through squared lengths only:
+        // ( ( L2 + L3 )^2 - L4^2 ) * ( L4^2 - ( L3 - L2 )^2 )
+        auto K4 = ( int32_t ) isqrt_mul32( L4_2_MAX_FX - L4_2, L4_2 - L4_2_MIN_FX );
+
+        coxa = atan_fx( -Py, Px );
+        femur = atan2_fx( K4, L2_2_FX + L4_2 - L3_2_FX ) + atan_fx( Pz, D );
+        tibia = atan2_fx( K4, L4_2 - L2_2_FX - L3_2_FX );
+    }
+
+    void evaluate( const Vec3f& pos, const Leg::Config& legConfig, bool inverted, int& coxaValue, int& femurValue, int& tibiaValue )
+    {
+        int32_t coxa, femur, tibia;
+        solve( pos, coxa, femur, tibia );
+
+        if( inverted )
+        {
+            femur = -femur;
+            tibia = FX_ANGLE_180 - tibia;
+        }
+
+        coxaValue = fx_toDegrees( coxa + legConfig.coxaTrim * FX_ANGLE_ONE );
+        femurValue = fx_toDegrees( femur + legConfig.femurTrim * FX_ANGLE_ONE );
+        tibiaValue = fx_toDegrees( tibia + legConfig.tibiaTrim * FX_ANGLE_ONE );
+    }
+#elif IK_KERNEL == IK_KERNEL_TABLE
+    // Knee parts of femur and tibia angles (the acos terms) depend only on L4^2 = R^2 + Pz^2,
+    // where R = P0 - L1 is the planar reach, so they are tabulated over L4^2.
+    // The table step is a power of two, so the table position is a bit field of the Q14 L4^2.
+    // The remaining atan( Pz / R ) and coxa atan( -Py / Px ) terms share one atan table
+    // on [0; 1] which is extended by symmetry, its position costs one integer division.
+    // Table values are degrees as Q7 numbers, positions and fractions are Q10, interpolated angles are Q17.
+    static const int TABLE_SHIFT = 7;
+    static const int FRACTION_SHIFT = 10;
+    static const int32_t TABLE_ONE = 1L << TABLE_SHIFT;
+    static const int32_t FRACTION_ONE = 1L << FRACTION_SHIFT;
+    static const int32_t TABLE_ANGLE_ONE = 1L << ( TABLE_SHIFT + FRACTION_SHIFT );
+
+    // the leg is never folded closer than this, the table ends at the fully stretched leg
+    static const int TABLE_L4_MIN = 40;
+    static const long TABLE_L4_2_MIN = ( long ) TABLE_L4_MIN * TABLE_L4_MIN;
+    static const long TABLE_L4_2_STEP = 1L << IK_TABLE_STEP_SHIFT;
+    static const long TABLE_L4_2_REACH = ( long ) ( Leg::Config::L2 + Leg::Config::L3 ) * ( Leg::Config::L2 + Leg::Config::L3 );
+    static const int IK_TABLE_SIZE = ( TABLE_L4_2_REACH - TABLE_L4_2_MIN + TABLE_L4_2_STEP - 1 ) / TABLE_L4_2_STEP + 1;
+    static const int IK_ATAN_TABLE_SIZE = ( 1 << IK_ATAN_TABLE_SHIFT ) + 1;
+
+    // Q14 L4^2 of the first entry, Q14 L4^2 -> Q10 position
+    static const int32_t TABLE_L4_2_MIN_FX = ( int32_t ) TABLE_L4_2_MIN << ( 2 * FX_LENGTH_SHIFT );
+    static const int TABLE_POSITION_SHIFT = 2 * FX_LENGTH_SHIFT + IK_TABLE_STEP_SHIFT - FRACTION_SHIFT;
+
+    static_assert( TABLE_POSITION_SHIFT >= 0, "IK_TABLE_STEP_SHIFT is too small for the table fraction" );
+    // Q7 lengths are below 2^15, the atan ratio numerator must fit into 31 bits
+    static_assert( IK_ATAN_TABLE_SHIFT + FRACTION_SHIFT <= 16, "IK_ATAN_TABLE_SHIFT is too large" );
+
+    // knee triangle is considered degenerate above this |cos|, the error is not estimated there
+    static constexpr double WELL_CONDITIONED_COS = 0.99;
+
+    constexpr double tableL4_2( double index )
+    {
+        return TABLE_L4_2_MIN + index * double( TABLE_L4_2_STEP );
+    }
+
+    // the last entry may lie past the fully stretched leg, cos is clamped there
+    constexpr double femurCos( double L4_2 )
+    {
+        return const_clamp( ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * const_sqrt( L4_2 ) ), -1, 1 );
+    }
+
+    constexpr double tibiaCos( double L4_2 )
+    {
+        return const_clamp( ( L4_2 - L2_2 - L3_2 ) / ( 2.0 * Leg::Config::L2 * Leg::Config::L3 ), -1, 1 );
+    }
+
+    constexpr int16_t toTable( double rad )
+    {
+        return int16_t( const_round( const_degrees( rad ) * TABLE_ONE ) );
+    }
+
+    struct FemurGenerator
+    {
+        typedef int16_t Type;
+        static const int SIZE = IK_TABLE_SIZE;
+
+        static constexpr double exact( double index )
+        {
+            return const_acos( femurCos( tableL4_2( index ) ) );
+        }
+
+        static constexpr Type value( int index )
+        {
+            return toTable( exact( index ) );
+        }
+    };
+
+    struct TibiaGenerator
+    {
+        typedef int16_t Type;
+        static const int SIZE = IK_TABLE_SIZE;
+
+        static constexpr double exact( double index )
+        {
+            return const_acos( tibiaCos( tableL4_2( index ) ) );
+        }
+
+        static constexpr Type value( int index )
+        {
+            return toTable( exact( index ) );
+        }
+    };
+
+    struct AtanGenerator
+    {
+        typedef int16_t Type;
+        static const int SIZE = IK_ATAN_TABLE_SIZE;
+
+        static constexpr double exact( double index )
+        {
+            return const_atan( index / ( SIZE - 1 ) );
+        }
+
+        static constexpr Type value( int index )
+        {
+            return toTable( exact( index ) );
+        }
+    };
+
+    typedef StaticTable< FemurGenerator > FemurTable;
+    typedef StaticTable< TibiaGenerator > TibiaTable;
+    typedef StaticTable< AtanGenerator > AtanTable;
+
+    // Error estimation: interpolation error is max at interval centers
+
+    constexpr bool wellConditioned( int index )
+    {
+        return const_abs( femurCos( tableL4_2( index ) ) ) <= WELL_CONDITIONED_COS &&
+            const_abs( tibiaCos( tableL4_2( index ) ) ) <= WELL_CONDITIONED_COS;
+    }
+
+    template< class Generator >
+    constexpr double intervalError( int index, bool checkConditioning )
+    {
+        return !checkConditioning || ( wellConditioned( index ) && wellConditioned( index + 1 ) ) ?
+            const_abs( ( Generator::value( index ) + Generator::value( index + 1 ) ) / ( 2.0 * TABLE_ONE ) -
+                       const_degrees( Generator::exact( index + 0.5 ) ) ) : 0;
+    }
+
+    // splits the range in halves to keep constexpr recursion shallow
+    template< class Generator >
+    constexpr double maxError( int first, int last, bool checkConditioning )
+    {
+        return last - first == 1 ?
+            intervalError< Generator >( first, checkConditioning ) :
+            const_max( maxError< Generator >( first, ( first + last ) / 2, checkConditioning ),
+                       maxError< Generator >( ( first + last ) / 2, last, checkConditioning ) );
+    }
+
+    static constexpr double ATAN_TABLE_ERROR = maxError< AtanGenerator >( 0, IK_ATAN_TABLE_SIZE - 1, false );
+    static constexpr double IK_TABLE_ERROR = const_max( maxError< FemurGenerator >( 0, IK_TABLE_SIZE - 1, true ) + ATAN_TABLE_ERROR,
+                                                        maxError< TibiaGenerator >( 0, IK_TABLE_SIZE - 1, true ) );
+    static const int IK_TABLE_BYTES = sizeof( FemurTable::data ) + sizeof( TibiaTable::data ) + sizeof( AtanTable::data );
+
+    static_assert( IK_TABLE_ERROR <= IK_TABLE_MAX_ERROR, "IK_TABLE_STEP_SHIFT is too large for IK_TABLE_MAX_ERROR" );
+
+    // interpolates table at the Q10 position clamping it to the table range
+    int32_t interpolate( const int16_t* table, int size, int32_t position )
+    {
+        int index = 0;
+        int32_t fraction = 0;
+
+        if( position >= ( int32_t ) ( size - 1 ) << FRACTION_SHIFT )
+        {
+            index = size - 2;
+            fraction = FRACTION_ONE;
+        }
+        else if( position > 0 )
+        {
+            index = position >> FRACTION_SHIFT;
+            fraction = position & ( FRACTION_ONE - 1 );
+        }
+
+        int32_t v0 = ( int16_t ) pgm_read_word( &table[index] );
+        int32_t v1 = ( int16_t ) pgm_read_word( &table[index + 1] );
+        return v0 * FRACTION_ONE + ( v1 - v0 ) * fraction;
+    }
+
+    // atan( y / x ) keeping the float kernel branch for negative x
+    int32_t atanTable( int32_t y, int32_t x )
+    {
+        bool negative = ( y < 0 ) != ( x < 0 );
+        y = abs( y );
+        x = abs( x );
+
+        bool inverse = y > x;
+        auto numerator = inverse ? x : y;
+        auto denominator = inverse ? y : x;
+        if( denominator == 0 )
+            return 0;
+
+        auto position = ( numerator << ( IK_ATAN_TABLE_SHIFT + FRACTION_SHIFT ) ) / denominator;
+        auto res = interpolate( AtanTable::data, IK_ATAN_TABLE_SIZE, position );
+
+        if( inverse )
+            res = 90 * TABLE_ANGLE_ONE - res;
+
+        return negative ? -res : res;
+    }
+
+    // Q17 joint angles before inversion and trims
+    // Max deviation from the float kernel ( Host/IkTableTest, sweep of the leg workspace ):
+    //  coxa - 0.013 deg
+    //  femur, tibia - 0.08, 0.14 deg while |cos| of the knee triangle angles <= 0.99,
+    //                 1.0, 1.7 deg while <= 0.999, where the acos terms are steep between two entries
+    // IK_TABLE_ERROR is lower as it skips the intervals which reach out of the well conditioned range
+    void solve( const Vec3f& pos, int32_t& coxa, int32_t& femur, int32_t& tibia )
+    {
+        auto Px = toFixed( pos[0] );
+        auto Py = toFixed( pos[1] );
+        auto Pz = toFixed( pos[2] );
+
+        auto R = ( int32_t ) isqrt32( Px * Px + Py * Py ) - L1_FX;
+        auto position = ( R * R + Pz * Pz - TABLE_L4_2_MIN_FX ) >> TABLE_POSITION_SHIFT;
+
+        coxa = atanTable( -Py, Px );
+        femur = interpolate( FemurTable::data, IK_TABLE_SIZE, position ) + atanTable( Pz, R );
+        tibia = interpolate( TibiaTable::data, IK_TABLE_SIZE, position );
+    }
+
+    void evaluate( const Vec3f& pos, const Leg::Config& legConfig, bool inverted, int& coxaValue, int& femurValue, int& tibiaValue )
+    {
+        int32_t coxa, femur, tibia;
+        solve( pos, coxa, femur, tibia );
+
+        if( inverted )
+        {
+            femur = -femur;
+            tibia = 180 * TABLE_ANGLE_ONE - tibia;
+        }
+
+        coxaValue = ( coxa + legConfig.coxaTrim * TABLE_ANGLE_ONE ) / TABLE_ANGLE_ONE;
+        femurValue = ( femur + legConfig.femurTrim * TABLE_ANGLE_ONE ) / TABLE_ANGLE_ONE;
+        tibiaValue = ( tibia + legConfig.tibiaTrim * TABLE_ANGLE_ONE ) / TABLE_ANGLE_ONE;
+    }
+#else
+#if USE_FAST_MATH
+    inline float ik_sqrt( float x )
+    {
+        return fast_sqrt( x );
+    }
+
+    inline float ik_acos( float x )
+    {
+        return fast_acos( x );
+    }
+
+    // atan( y / x ), result is in range [-pi/2; pi/2]
+    inline float ik_atan( float y, float x )
+    {
+        return x < 0 ? fast_atan2( -y, -x ) : fast_atan2( y, x );
+    }
+#else
+    inline float ik_sqrt( float x )
+    {
+        return sqrt( x );
+    }
+
+    inline float ik_acos( float x )
+    {
+        return acos( x );
+    }
 
-        coxaValue = degrees( atan( -pos[1] / pos[0] ) ) + legConfig.coxaTrim;
-        float fFemurValue = acos( ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * L4 ) ) + atan( pos[2] / ( P0 - Leg::Config::L1 ) );
-        if( legConfig.inverted )
+    inline float ik_atan( float y, float x )
+    {
+        return atan( y / x );
+    }
+#endif
+
+    // joint angles in radians before inversion and trims
+    struct Joints
+    {
+        float coxa;
+        float femur;
+        float tibia;
+    };
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL || !USE_SERVO_TICKS
+    // servo degrees with trims
+    void toServo( const Joints& joints, const Leg::Config& legConfig, bool inverted, float& coxaValue, float& femurValue, float& tibiaValue )
+    {
+        coxaValue = degrees( joints.coxa ) + legConfig.coxaTrim;
+
+        float fFemurValue = joints.femur;
+        if( inverted )
             fFemurValue = -fFemurValue;
         femurValue = degrees( fFemurValue ) + legConfig.femurTrim;
 
-        float fTibiaValue = acos( ( L4_2 - L2_2 - L3_2 ) / ( 2 * Leg::Config::L2 * Leg::Config::L3 ) );
-        if( legConfig.inverted )
+        float fTibiaValue = joints.tibia;
+        if( inverted )
             fTibiaValue = M_PI - fTibiaValue;
-
         tibiaValue = degrees( fTibiaValue ) + legConfig.tibiaTrim;
     }
+#endif
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    // the controller takes fractional degrees, channels of a leg follow each other
+    void writeServos( const Joints& joints, const Leg::Config& legConfig, bool inverted, int channel )
+    {
+        float coxaValue, femurValue, tibiaValue;
+        toServo( joints, legConfig, inverted, coxaValue, femurValue, tibiaValue );
+
+        SerialServos::write( channel, coxaValue );
+        SerialServos::write( channel + 1, femurValue );
+        SerialServos::write( channel + 2, tibiaValue );
+    }
+#elif USE_SERVO_TICKS
+    // trims and inversion are folded into the servo calibration, see Leg::calibrate
+    void writeServos( const Joints& joints, const Leg::Config&, bool, ServoEx& coxa, ServoEx& femur, ServoEx& tibia )
+    {
+        coxa.writeCalibrated( joints.coxa );
+        femur.writeCalibrated( joints.femur );
+        tibia.writeCalibrated( joints.tibia );
+    }
+#else
+    void toServo( const Joints& joints, const Leg::Config& legConfig, bool inverted, int& coxaValue, int& femurValue, int& tibiaValue )
+    {
+        float fCoxaValue, fFemurValue, fTibiaValue;
+        toServo( joints, legConfig, inverted, fCoxaValue, fFemurValue, fTibiaValue );
+        coxaValue = fCoxaValue;
+        femurValue = fFemurValue;
+        tibiaValue = fTibiaValue;
+    }
+
+    void writeServos( const Joints& joints, const Leg::Config& legConfig, bool inverted, ServoEx& coxa, ServoEx& femur, ServoEx& tibia )
+    {
+        int coxaValue, femurValue, tibiaValue;
+        toServo( joints, legConfig, inverted, coxaValue, femurValue, tibiaValue );
+
+        coxa.write( coxaValue );
+        femur.write( femurValue );
+        tibia.write( tibiaValue );
+    }
+#endif
+
+#if IK_INCREMENTAL
+    // targets farther than this from the previous one are solved in closed form, mm
+    static const float IK_MAX_STEP = 10.0f;
+    static const float IK_MAX_STEP_2 = IK_MAX_STEP * IK_MAX_STEP;
+    // max joint angle error of the step, estimated from the distance between the target and the forward
+    // kinematics of the step: the distance maps to about max( L3, L4 ) / ( L2 * L3 * sin( tibia ) ) radians,
+    // so the leg must come closer where it is stretched or folded ( 0.15 deg keeps the joint angles within
+    // 0.2 deg of the closed form, see Host/IkFloatTest.cpp )
+    static const float IK_MAX_ERROR = const_radians( 0.15 );
+    static const float IK_MAX_RESIDUAL_SCALE = IK_MAX_ERROR * Leg::Config::L2 * Leg::Config::L3;
+    // Jacobian determinant is L2 * L3 * sin( tibia ), keep away from the stretched/folded leg
+    static const float IK_MIN_SIN_TIBIA = 0.05f;
+    // Newton iterations before giving up
+    static const int IK_MAX_ITERATIONS = 2;
+
+    Leg::IkStats ikStats {};
+
+    void solve( const Vec3f& pos, Joints& joints, Leg::IkState& state )
+    {
+        auto Px_2 = pos[0] * pos[0];
+        auto Py_2 = pos[1] * pos[1];
+        auto Pz_2 = pos[2] * pos[2];
+
+        auto P0 = ik_sqrt( Px_2 + Py_2 );
+        auto D = P0 - Leg::Config::L1;
+        auto L4_2 = D * D + Pz_2;
+        auto L4 = ik_sqrt( L4_2 );
+
+        auto cosKnee = ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * L4 );
+        auto cosTibia = ( L4_2 - L2_2 - L3_2 ) / ( 2 * Leg::Config::L2 * Leg::Config::L3 );
+
+        joints.coxa = ik_atan( -pos[1], pos[0] );
+        joints.femur = ik_acos( cosKnee ) + ik_atan( pos[2], D );
+        joints.tibia = ik_acos( cosTibia );
+
+        // the incremental path continues from here, it expects the leg in front of the coxa
+        state.valid = pos[0] > 0 && D > 0 && fabs( cosKnee ) < 1 && fabs( cosTibia ) < 1;
+        if( !state.valid )
+            return;
+
+        state.target = pos;
+        state.coxa = joints.coxa;
+        state.cosCoxa = pos[0] / P0;
+        state.sinCoxa = -pos[1] / P0;
+
+        // femur = knee + elevation of the L4 line
+        auto sinKnee = ik_sqrt( 1 - cosKnee * cosKnee );
+        auto cosElev = D / L4;
+        auto sinElev = pos[2] / L4;
+        state.femur = joints.femur;
+        state.cosFemur = cosKnee * cosElev - sinKnee * sinElev;
+        state.sinFemur = sinKnee * cosElev + cosKnee * sinElev;
+
+        auto sinTibia = ik_sqrt( 1 - cosTibia * cosTibia );
+        state.tibia = joints.tibia;
+        state.cosTibiaDir = state.cosFemur * cosTibia + state.sinFemur * sinTibia;
+        state.sinTibiaDir = state.sinFemur * cosTibia - state.cosFemur * sinTibia;
+    }
+
+    // Newton steps from the cached solution, returns false if the closed form is required
+    bool solveIncremental( const Vec3f& pos, Joints& joints, Leg::IkState& state )
+    {
+        if( !state.valid )
+            return false;
+
+        if( ( pos - state.target ).length2() > IK_MAX_STEP_2 )
+        {
+            ++ikStats.largeStep;
+            return false;
+        }
+
+        // target in the leg plane of the cached coxa angle: radial and tangential parts
+        auto r = pos[0] * state.cosCoxa - pos[1] * state.sinCoxa;
+        auto h = pos[0] * state.sinCoxa + pos[1] * state.cosCoxa;
+        if( r <= Leg::Config::L1 )
+            return false;
+
+        // sin/cos are evaluated from the angles, so they never drift apart
+        auto coxa = state.coxa - h / r;
+        float cosCoxa, sinCoxa;
+        fast_sincos( coxa, sinCoxa, cosCoxa );
+
+        // radial distance and what is left off the new leg plane
+        auto D = pos[0] * cosCoxa - pos[1] * sinCoxa - Leg::Config::L1;
+        auto h1 = pos[0] * sinCoxa + pos[1] * cosCoxa;
+        auto L_2 = max( D * D + pos[2] * pos[2], float( L3_2 ) );
+
+        auto femur = state.femur;
+        auto cosFemur = state.cosFemur;
+        auto sinFemur = state.sinFemur;
+        auto tibia = state.tibia;
+        auto cosTibiaDir = state.cosTibiaDir;
+        auto sinTibiaDir = state.sinTibiaDir;
+
+        // Newton iterations on the planar ( D, z ) position, the first one
+        // starts from the error of the cached femur/tibia angles
+        int iteration = 0;
+        for( ;; )
+        {
+            auto Dc = Leg::Config::L2 * cosFemur + Leg::Config::L3 * cosTibiaDir;
+            auto Zc = Leg::Config::L2 * sinFemur + Leg::Config::L3 * sinTibiaDir;
+            auto eD = D - Dc;
+            auto eZ = pos[2] - Zc;
+
+            // sin( tibia ) = sin( femur - tibiaDir )
+            auto sinTibia = sinFemur * cosTibiaDir - cosFemur * sinTibiaDir;
+
+            // NaN fails the check and ends up in the closed form
+            auto maxResidual = IK_MAX_RESIDUAL_SCALE * sinTibia;
+            if( ( eD * eD + eZ * eZ + h1 * h1 ) * L_2 <= maxResidual * maxResidual )
+                break;
+
+            if( iteration++ == IK_MAX_ITERATIONS )
+            {
+                ++ikStats.residual;
+                return false;
+            }
+
+            if( fabs( sinTibia ) < IK_MIN_SIN_TIBIA )
+            {
+                ++ikStats.singular;
+                return false;
+            }
+
+            // inverse of the planar Jacobian d( D, z ) / d( femur, tibia )
+            auto k = 1.0f / ( Leg::Config::L2 * sinTibia );
+            femur -= ( cosTibiaDir * eD + sinTibiaDir * eZ ) * k;
+            tibia -= ( Dc * eD + Zc * eZ ) * k / Leg::Config::L3;
+
+            fast_sincos( femur, sinFemur, cosFemur );
+            fast_sincos( femur - tibia, sinTibiaDir, cosTibiaDir );
+        }
+
+        state.target = pos;
+        state.coxa = coxa;
+        state.cosCoxa = cosCoxa;
+        state.sinCoxa = sinCoxa;
+        state.femur = femur;
+        state.cosFemur = cosFemur;
+        state.sinFemur = sinFemur;
+        state.tibia = tibia;
+        state.cosTibiaDir = cosTibiaDir;
+        state.sinTibiaDir = sinTibiaDir;
+
+        joints.coxa = state.coxa;
+        joints.femur = state.femur;
+        joints.tibia = state.tibia;
+        return true;
+    }
+
+    void evaluate( const Vec3f& pos, Leg::IkState& state, Joints& joints )
+    {
+        if( solveIncremental( pos, joints, state ) )
+        {
+            ++ikStats.incremental;
+        }
+        else
+        {
+            ++ikStats.closedForm;
+            solve( pos, joints, state );
+        }
+    }
+#else
+    void evaluate( const Vec3f& pos, Joints& joints )
+    {
+        auto Px_2 = pos[0] * pos[0];
+        auto Py_2 = pos[1] * pos[1];
+        auto Pz_2 = pos[2] * pos[2];
+
+        auto P0 = ik_sqrt( Px_2 + Py_2 );
+        auto L4_2 = ( P0 - Leg::Config::L1 ) * ( P0 - Leg::Config::L1 ) + Pz_2;
+        auto L4 = ik_sqrt( L4_2 );
+
+        joints.coxa = ik_atan( -pos[1], pos[0] );
+        joints.femur = ik_acos( ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * L4 ) ) + ik_atan( pos[2], P0 - Leg::Config::L1 );
+        joints.tibia = ik_acos( ( L4_2 - L2_2 - L3_2 ) / ( 2 * Leg::Config::L2 * Leg::Config::L3 ) );
+    }
+#endif
+#endif
 }
 
 
 Leg::Config& Leg::getConfig( int index )
 {
-    static Config s_config[] = {
-        /*0*/ { 4, 3, 2, false,    Vec3f { 63.3, 37.8, 0 },  Quat( Vec3f::Z(), radians( 45 ) ),   93, 100, 3 },
-        /*1*/ { 50, 51, 52, true,  Vec3f { 0, 63, 0 },       Quat( Vec3f::Z(), radians( 90 ) ),   93, 100, 3 },
-        /*2*/ { 46, 47, 48, true,  Vec3f { -63.3, 37.8, 0 }, Quat( Vec3f::Z(), radians( 135 ) ),  93, 100, 3 },
-        /*3*/ { 13, 12, 11, false, Vec3f { -63.3, -37.8, 0 },Quat( Vec3f::Z(), radians( -135 ) ), 93, 100, 3 },
-        /*4*/ { 10, 9, 8, false,   Vec3f { 0, -63, 0 },      Quat( Vec3f::Z(), radians( -90 ) ),  93, 100, 3 },
-        /*5*/ { 7, 6, 5, true,     Vec3f { 63.3, -37.8, 0 }, Quat( Vec3f::Z(), radians( -45 ) ),  93, 100, 3 }
-    };
-
     return s_config[index];
 }
 
 void Leg::loadConfig()
 {
 #ifdef DEBUG_TRACE
+#if IK_KERNEL == IK_KERNEL_TABLE
+    Serial.print( "IK tables: " );
+    Serial.print( IK_TABLE_BYTES );
+    Serial.print( " bytes, max error: " );
+    Serial.println( IK_TABLE_ERROR );
+#endif
     Serial.println( "Load Trims: " );
 #endif
     int addr = 0;
@@ -112,38 +768,128 @@ void Leg::saveConfig()
     }
 }
 
+#if IK_INCREMENTAL
+const Leg::IkStats& Leg::getIkStats()
+{
+    return ikStats;
+}
+
+void Leg::printIkStats()
+{
+#ifdef DEBUG_TRACE
+    Serial.print( "IK incremental: " );
+    Serial.print( ikStats.incremental );
+    Serial.print( " closed form: " );
+    Serial.print( ikStats.closedForm );
+    Serial.print( " (step: " );
+    Serial.print( ikStats.largeStep );
+    Serial.print( " singular: " );
+    Serial.print( ikStats.singular );
+    Serial.print( " residual: " );
+    Serial.print( ikStats.residual );
+    Serial.println( ")" );
+#endif
+}
+#endif
 
 Leg::Leg( )
     : m_config( nullptr )
+    , m_inverted( false )
+    , m_saturations( 0 )
 {   
+#if IK_INCREMENTAL
+    m_ik.valid = false;
+#endif
 }
 
 Leg::~Leg()
 {
 }
 
-void Leg::init( const Leg::Config& config )
+void Leg::init( int index )
 {
-    m_config = &config;
+    const auto& geometry = legGeometry( index );
+    m_config = &getConfig( index );
+    m_inverted = pgm_read_byte( &geometry.inverted );
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    m_channel = index * 3;
+
+    setPos( getHome(), true );
+#else
 
     setPos( getHome(), true );
 
-    m_coxa.attach( m_config->coxaPin );
-    m_femur.attach( m_config->femurPin );
-    m_tibia.attach( m_config->tibiaPin );
+    m_coxa.attach( pgm_read_byte( &geometry.coxaPin ) );
+    m_femur.attach( pgm_read_byte( &geometry.femurPin ) );
+    m_tibia.attach( pgm_read_byte( &geometry.tibiaPin ) );
+
+    // joints of a leg share one timer, the interval applies to the whole group
+    if( !m_coxa.setRefreshInterval( SERVO_REFRESH_INTERVAL ) )
+    {
+#ifdef DEBUG_TRACE
+        Serial.print( "Leg: " );
+        Serial.print( index );
+        Serial.print( " refresh interval too short, using " );
+        Serial.println( m_coxa.refreshInterval() );
+#endif
+    }
+
+#if SERVO_SLEW
+    // limits per frame depend on the refresh interval set above
+    m_coxa.setSlewLimits( SERVO_MAX_SPEED, SERVO_MAX_ACCEL );
+    m_femur.setSlewLimits( SERVO_MAX_SPEED, SERVO_MAX_ACCEL );
+    m_tibia.setSlewLimits( SERVO_MAX_SPEED, SERVO_MAX_ACCEL );
+#endif
+    m_coxa.setTravelLimit( SERVO_TRAVEL_LIMIT );
+#endif
 }
 
 void Leg::setPos( const Vec3f & value, bool force = false )
 {
     if( !m_position.equal( value, F_TOLERANCE ) || force )
     {
-        int coxa, femur, tibia;
         m_position = value;
-        evaluate( m_position, *m_config, coxa, femur, tibia );
 
+        auto target = value;
+        if( clampToWorkspace( target ) )
+            ++m_saturations;
+
+#if IK_KERNEL == IK_KERNEL_FLOAT
+        Joints joints;
+#if IK_INCREMENTAL
+        if( force )
+            m_ik.valid = false;
+        evaluate( target, m_ik, joints );
+#else
+        evaluate( target, joints );
+#endif
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+        writeServos( joints, *m_config, m_inverted, m_channel );
+#else
+        // trims may have been changed
+        if( force )
+            calibrate();
+        // the three joints of the leg are pulsed from the same frame
+        ServoFrame.start();
+        writeServos( joints, *m_config, m_inverted, m_coxa, m_femur, m_tibia );
+        ServoFrame.publish();
+#endif
+#else
+        int coxa, femur, tibia;
+        evaluate( target, *m_config, m_inverted, coxa, femur, tibia );
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+        SerialServos::write( m_channel, coxa );
+        SerialServos::write( m_channel + 1, femur );
+        SerialServos::write( m_channel + 2, tibia );
+#else
+        ServoFrame.start();
         m_coxa.write( coxa );
         m_femur.write( femur );
         m_tibia.write( tibia );
+        ServoFrame.publish();
+#endif
+#endif
     }
 }
 
@@ -152,6 +898,60 @@ const Vec3f & Leg::getPos() const
     return m_position;
 }
 
+void Leg::calibrate()
+{
+#if IK_KERNEL == IK_KERNEL_FLOAT && USE_SERVO_TICKS && SERVO_OUTPUT == SERVO_OUTPUT_PWM
+    // joint angles in radians that map to 0 and 180 servo degrees, see toServo
+    m_coxa.calibrate( radians( -m_config->coxaTrim ), radians( 180 - m_config->coxaTrim ) );
+    if( m_inverted )
+    {
+        m_femur.calibrate( radians( m_config->femurTrim ), radians( m_config->femurTrim - 180 ) );
+        m_tibia.calibrate( radians( 180 + m_config->tibiaTrim ), radians( m_config->tibiaTrim ) );
+    }
+    else
+    {
+        m_femur.calibrate( radians( -m_config->femurTrim ), radians( 180 - m_config->femurTrim ) );
+        m_tibia.calibrate( radians( -m_config->tibiaTrim ), radians( 180 - m_config->tibiaTrim ) );
+    }
+#endif
+}
+
+unsigned long Leg::getSaturations() const
+{
+    return m_saturations;
+}
+
+unsigned long Leg::getSlewSaturations()
+{
+#if SERVO_OUTPUT == SERVO_OUTPUT_PWM && SERVO_SLEW
+    return ( unsigned long ) m_coxa.slewSaturations() + m_femur.slewSaturations() + m_tibia.slewSaturations();
+#else
+    return 0;
+#endif
+}
+
+void Leg::printServoTiming( int index )
+{
+#if defined( DEBUG_TRACE ) && SERVO_OUTPUT == SERVO_OUTPUT_PWM
+    Serial.print( "Leg: " );
+    Serial.print( index );
+    Serial.print( " servo timer " );
+    Serial.print( m_coxa.timer() );
+    Serial.print( " worst case frame " );
+    Serial.print( m_coxa.frameLength() );
+    Serial.print( " us of " );
+    Serial.print( m_coxa.refreshInterval() );
+#if SERVO_HARDWARE_PWM
+    // joints on output compare pins of a timer without other servos are pulsed without the ISR
+    Serial.print( ", hardware PWM joints " );
+    Serial.print( m_coxa.hardware() + m_femur.hardware() + m_tibia.hardware() );
+#endif
+    Serial.println();
+#else
+    ( void ) index;
+#endif
+}
+
 const Vec3f & Leg::getCenter() const
 {
     return CENTER;
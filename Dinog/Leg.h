@@ -1,9 +1,51 @@
 #pragma once
 
 #include <Vec3f.h>
-#include <Quat.h>
+
 #include <ServoEx.h>
 
+// Allocation of the 18 joint servos to the servo timers ( PWM output ): two legs on each of timers 5, 1 and 3
+// instead of filling timer 5 with 12 servos.  LegController::init applies it with ServoEx::allocate
+// before the first leg attaches its servos
+#define SERVO_ALLOCATION_JOINTS 18
+#define SERVO_ALLOCATION_LEG    3
+
+// Incremental IK (float kernel only): joint angles are updated with a Jacobian step
+// from the previous solution, the closed form is used when the target moves too far
+// or the residual error of the step is too big
+#ifndef IK_INCREMENTAL
+#define IK_INCREMENTAL 0
+#endif
+
+// Servo output backends:
+// PWM    - pulses generated by the ServoEx timer interrupts
+// SERIAL - targets of all legs sent to an external controller on a UART as often as the link carries them,
+//          see SerialServos.h
+#define SERVO_OUTPUT_PWM    0
+#define SERVO_OUTPUT_SERIAL 1
+
+#ifndef SERVO_OUTPUT
+#define SERVO_OUTPUT SERVO_OUTPUT_PWM
+#endif
+
+// Servo refresh interval in microseconds, set for every servo timer on init (PWM output)
+// Analog servos need 20000 (50 Hz), digital servos accept down to 3000 (333 Hz)
+// With the allocation above the shortest interval the timers accept is 2408 with the concurrent
+// scheduler and 14400 with the sequential one
+#define SERVO_REFRESH_INTERVAL 20000
+
+// Slew limits of every joint servo ( PWM output ), enforced by the servo interrupt so a snap like
+// centerLeg does not step all servos at once and brown out the board.
+// Pulse width change in microseconds per second and per second squared, 0 disables the limit,
+// about 10 microseconds per degree
+#define SERVO_MAX_SPEED 6000
+#define SERVO_MAX_ACCEL 120000
+
+// Sum of the pulse width changes per frame of the joints on one servo timer ( two legs, PWM output ), in microseconds.
+// Caps the current all servos of a timer draw together when they start moving, large steps are spread over
+// several frames in proportion.  0 disables the limit
+#define SERVO_TRAVEL_LIMIT 480
+
 class Leg
 {
 public:
@@ -13,18 +55,38 @@ public:
         static const int L2 = 55;
         static const int L3 = 80;
 
-        int coxaPin;
-        int femurPin;
-        int tibiaPin;
-        bool inverted;
-        Vec3f offset;
-        Quat rotation;
-
         int coxaTrim;
         int femurTrim;
         int tibiaTrim;
     };
 
+#if IK_INCREMENTAL
+    // cached joint solution, angles are radians before inversion and trims
+    struct IkState
+    {
+        bool valid;
+        float coxa, cosCoxa, sinCoxa;
+        float femur, cosFemur, sinFemur;
+        float tibia;
+        // direction of the tibia segment in the leg plane ( femur - tibia )
+        float cosTibiaDir, sinTibiaDir;
+        Vec3f target;
+    };
+
+    // number of solutions taken by each path, all legs together
+    struct IkStats
+    {
+        unsigned long incremental;
+        unsigned long closedForm;
+        unsigned long largeStep;
+        unsigned long singular;
+        unsigned long residual;
+    };
+
+    static const IkStats& getIkStats();
+    static void printIkStats();
+#endif
+
     static Config& getConfig( int index );
     static void loadConfig();
     static void saveConfig();
@@ -32,17 +94,38 @@ public:
     Leg();
     ~Leg();
 
-    void init( const Config& config );
+    void init( int index );
 
     void setPos( const Vec3f& value, bool force = false );
+    // requested position, it may lie outside of the reachable workspace
     const Vec3f& getPos() const;
+    // number of setPos calls whose target was projected onto the workspace
+    unsigned long getSaturations() const;
+    // number of servo frames the slew limits held a joint back, all joints together
+    unsigned long getSlewSaturations();
+    // prints the servo timer of the leg, its worst case frame length and the number of joints
+    // in hardware PWM mode ( DEBUG_TRACE )
+    void printServoTiming( int index );
     const Vec3f& getCenter() const;
     const Vec3f& getHome() const;
 
 private:
+    // folds trims and inversion into the servo calibration
+    void calibrate();
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    // controller channel of the coxa, femur and tibia follow
+    int m_channel;
+#else
     ServoEx m_coxa;
     ServoEx m_femur;
     ServoEx m_tibia;
+#endif
     Vec3f m_position;
     const Config* m_config;
+    bool m_inverted;
+    unsigned long m_saturations;
+#if IK_INCREMENTAL
+    IkState m_ik;
+#endif
 };
@@ -1,8 +1,11 @@
 #include "LegController.h"
 #include "Common.h"
+#include "LegGeometry.h"
+#include "SerialServos.h"
 
 #include <Arduino.h>
 #include <MathUtils.h>
+#include <Quat.h>
 
 namespace
 {
@@ -37,97 +40,159 @@ namespace
 
     static const float S_Z_SWING_ELEVATION = 37.0f;
     static const float SMOOTH_FACTOR = 4;
-
-    Vec3f evaluateSwing( float phaze, const Vec3f& p0, const Vec3f& p1 )
-    {
-        phaze = fabs( phaze );
-        auto midZ = max( p1[2], p0[2] ) + S_Z_SWING_ELEVATION;
-
-        return Vec3f { lerp( p1[0], p0[0], phaze ),
-            lerp( p1[1], p0[1], phaze ),
-            phaze < 0.5 ? lerp( p1[2], midZ, phaze ) : lerp( midZ, p0[2], phaze ) };
-    }
-
-    Vec3f evaluateStance( float phaze, const Vec3f& p0, const Vec3f& p1 )
-    {
-        return Vec3f { lerp( p0[0], p1[0], phaze ),
-                      lerp( p0[1], p1[1], phaze ),
-                      lerp( p0[2], p1[2], phaze ) };
-    }
+    static const float SMOOTH_GAIN = 1.0f / SMOOTH_FACTOR;
 }
 
 LegController::LegController()
-    : m_p0 { }
-    , m_p1 { }
-    , m_p { }
-    , m_pTmp { }
-    , m_rot { 1.0f }
 {}
 
 LegController::~LegController()
 {
 }
 
-void LegController::init( const Leg::Config& legConfig )
-{   
-    m_rot = legConfig.rotation.toMatrix3x3();
-    m_rot.inverse();
-
-    m_pTmp = m_p = m_p0 = m_p1 = m_leg.getHome();
-    m_leg.init( legConfig );  
-    m_stance = true;
+void LegController::init()
+{
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    SerialServos::init();
+#else
+    if( !ServoEx::allocate( SERVO_ALLOCATION_JOINTS, SERVO_ALLOCATION_LEG ) )
+    {
+#ifdef DEBUG_TRACE
+        Serial.print( "LegController: servos attached before init, keeping " );
+        Serial.print( ServoEx::servosPerTimer() );
+        Serial.println( " servos per timer" );
+#endif
+    }
+#endif
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        const auto& home = m_legs[i].getHome();
+        m_p0.set( i, home[0], home[1], home[2] );
+        m_p1.set( i, m_p0 );
+        m_p.set( i, m_p0 );
+        m_pTmp.set( i, m_p0 );
+
+        m_legs[i].init( i );
+        m_stance[i] = true;
+    }
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    SerialServos::send();
+#else
+    // frames grow as legs are attached, report once all timers are set up
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        m_legs[i].printServoTiming( i );
+    }
+#endif
 }
 
-void LegController::setInput( const Vec3f& locomotionVector, float elevation, float phaze )
+void LegController::setInput( const LegInput& input )
 {
-    auto Vloc = m_rot.mult( locomotionVector );
-    auto Pc = m_leg.getCenter();
-    Pc[2] -= elevation; 
-    auto VlocHalf = Vloc * 0.5;
-    auto pT0 = Pc + VlocHalf;
-    auto pT1 = Pc - VlocHalf;
+    // all legs share the same center
+    const auto& Pc = m_legs[0].getCenter();
 
     // update end points
-    m_p0 = m_p0 + ( pT0 - m_p0 ) / SMOOTH_FACTOR;
-    m_p1 = m_p1 + ( pT1 - m_p1 ) / SMOOTH_FACTOR;
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        const auto& geometry = legGeometry( i );
+        auto rotXX = pgm_read_float( &geometry.rotXX );
+        auto rotXY = pgm_read_float( &geometry.rotXY );
+        auto rotYX = pgm_read_float( &geometry.rotYX );
+        auto rotYY = pgm_read_float( &geometry.rotYY );
+
+        auto VlocHalfX = ( rotXX * input.locomotionX[i] + rotXY * input.locomotionY[i] ) * 0.5f;
+        auto VlocHalfY = ( rotYX * input.locomotionX[i] + rotYY * input.locomotionY[i] ) * 0.5f;
+        auto Pz = Pc[2] - input.elevation[i];
+
+        m_p0.x[i] += ( Pc[0] + VlocHalfX - m_p0.x[i] ) * SMOOTH_GAIN;
+        m_p0.y[i] += ( Pc[1] + VlocHalfY - m_p0.y[i] ) * SMOOTH_GAIN;
+        m_p0.z[i] += ( Pz - m_p0.z[i] ) * SMOOTH_GAIN;
+
+        m_p1.x[i] += ( Pc[0] - VlocHalfX - m_p1.x[i] ) * SMOOTH_GAIN;
+        m_p1.y[i] += ( Pc[1] - VlocHalfY - m_p1.y[i] ) * SMOOTH_GAIN;
+        m_p1.z[i] += ( Pz - m_p1.z[i] ) * SMOOTH_GAIN;
+    }
+
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        bool stance = input.phase[i] >= 0;
 
-    bool stance = phaze >= 0;
+        if( m_stance[i] != stance )
+        {
+            // phaze switched
+            // if swing is activated, current leg position is used as p1 
+            // so, we can turn on swing at any time
+            m_pTmp.set( i, stance ? m_p1 : m_p );
+            m_stance[i] = stance;
+        }
+    }
 
-    if( m_stance != stance )
+    for( int i = 0; i < NUM_LEGS; ++i )
     {
-        // phaze switched
-        // if swing is activated, current leg position is used as p1 
-        // so, we can turn on swing at any time
+        auto phaze = input.phase[i];
 
-        if( !stance )
+        if( m_stance[i] )
         {
-            m_pTmp = m_p;
+            m_p.set( i, lerp( m_p0.x[i], m_p1.x[i], phaze ),
+                        lerp( m_p0.y[i], m_p1.y[i], phaze ),
+                        lerp( m_p0.z[i], m_p1.z[i], phaze ) );
         }
         else
         {
-            m_pTmp = m_p1;
+            // swing from p1 = m_pTmp to p0 through the elevated middle point
+            phaze = fabs( phaze );
+            auto midZ = max( m_pTmp.z[i], m_p0.z[i] ) + S_Z_SWING_ELEVATION;
+
+            m_p.set( i, lerp( m_pTmp.x[i], m_p0.x[i], phaze ),
+                        lerp( m_pTmp.y[i], m_p0.y[i], phaze ),
+                        phaze < 0.5 ? lerp( m_pTmp.z[i], midZ, phaze ) : lerp( midZ, m_p0.z[i], phaze ) );
         }
-        m_stance = stance;
     }
 
-    m_p = stance ? evaluateStance( phaze, m_p0, m_p1 ) :
-        evaluateSwing( phaze, m_p0, m_pTmp );
-    m_leg.setPos( m_p );
+    // whole pose is latched by the servo ISR at once, no frame mixes old and new leg positions
+#if SERVO_OUTPUT == SERVO_OUTPUT_PWM
+    ServoFrame.start();
+#endif
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        m_legs[i].setPos( Vec3f { m_p.x[i], m_p.y[i], m_p.z[i] } );
+    }
+#if SERVO_OUTPUT == SERVO_OUTPUT_PWM
+    ServoFrame.publish();
+#else
+    SerialServos::send();
+#endif
 }
 
-void LegController::moveToPos( const Vec3f& pos )
+void LegController::moveToPos( int leg, const Vec3f& pos )
 {
     Vec3f target;
 
-    auto center = m_leg.getCenter();
+    auto center = m_legs[leg].getCenter();
     target[0] = center[0] + pos[0];
     target[1] = center[1] + pos[1];
     target[2] = center[2];
 
-    m_leg.setPos( target );
+    m_legs[leg].setPos( target );
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    SerialServos::send();
+#endif
+}
+
+void LegController::centerLeg( int leg )
+{
+    m_legs[leg].setPos( m_legs[leg].getCenter(), true );
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+    SerialServos::send();
+#endif
+}
+
+unsigned long LegController::getSaturations( int leg ) const
+{
+    return m_legs[leg].getSaturations();
 }
 
-void LegController::centerLeg()
+unsigned long LegController::getSlewSaturations( int leg )
 {
-    m_leg.setPos( m_leg.getCenter(), true );
-}
\ No newline at end of file
+    return m_legs[leg].getSlewSaturations();
+}
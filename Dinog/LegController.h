@@ -1,28 +1,52 @@
 #pragma once
 
+#include "Common.h"
 #include "Leg.h"
 
 #include <Vec3f.h>
-#include <Mat3x3.h>
 
+// Controls all legs, state is kept as structure of arrays
 class LegController
 {
 public:
     LegController();
     ~LegController();
 
-    void init( const Leg::Config& legConfig );
+    void init();
 
-    void setInput( const Vec3f& locomotionVector, float elevation, float phaze );
+    void setInput( const LegInput& input );
 
     // used only if locomotion is disabled
-    void moveToPos( const Vec3f& pos );
-    void centerLeg();
+    void moveToPos( int leg, const Vec3f& pos );
+    void centerLeg( int leg );
 
-private:
-    Leg m_leg;
-    Vec3f m_p0, m_p1, m_p, m_pTmp;
-    Mat3x3 m_rot;
+    // number of targets projected onto the reachable workspace
+    unsigned long getSaturations( int leg ) const;
+    // number of servo frames the slew limits held a joint of the leg back
+    unsigned long getSlewSaturations( int leg );
 
-    bool m_stance;
+private:
+    struct Points
+    {
+        float x[NUM_LEGS] {};
+        float y[NUM_LEGS] {};
+        float z[NUM_LEGS] {};
+
+        void set( int i, float px, float py, float pz )
+        {
+            x[i] = px;
+            y[i] = py;
+            z[i] = pz;
+        }
+
+        void set( int i, const Points& other )
+        {
+            set( i, other.x[i], other.y[i], other.z[i] );
+        }
+    };
+
+    Leg m_legs[NUM_LEGS];
+    Points m_p0, m_p1, m_p, m_pTmp;
+
+    bool m_stance[NUM_LEGS] {};
 };
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Common.h"
+
+#include <ConstMath.h>
+#include <StaticTable.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+// Robot geometry, all values are evaluated at compile time and placed in flash
+// Fields must be read with pgm_read_byte / pgm_read_float
+struct LegGeometry
+{
+    uint8_t coxaPin;
+    uint8_t femurPin;
+    uint8_t tibiaPin;
+    uint8_t inverted;
+    // leg mount point in body frame
+    float offsetX;
+    float offsetY;
+    // inverse leg rotation ( body -> leg frame ), legs are rotated around Z so only XY part is kept
+    float rotXX;
+    float rotXY;
+    float rotYX;
+    float rotYY;
+    // unit tangent of the body rotation around Z at the mount point
+    float tangentX;
+    float tangentY;
+};
+
+namespace LegMounts
+{
+    struct Mount
+    {
+        uint8_t coxaPin;
+        uint8_t femurPin;
+        uint8_t tibiaPin;
+        bool inverted;
+        double offsetX;
+        double offsetY;
+        // rotation around Z, degrees
+        double angle;
+    };
+
+    static constexpr Mount MOUNTS[NUM_LEGS] = {
+        /*0*/ { 4, 3, 2, false,    63.3, 37.8,    45 },
+        /*1*/ { 50, 51, 52, true,  0, 63,         90 },
+        /*2*/ { 46, 47, 48, true,  -63.3, 37.8,   135 },
+        /*3*/ { 13, 12, 11, false, -63.3, -37.8,  -135 },
+        /*4*/ { 10, 9, 8, false,   0, -63,        -90 },
+        /*5*/ { 7, 6, 5, true,     63.3, -37.8,   -45 }
+    };
+
+    constexpr double length( const Mount& m )
+    {
+        return const_sqrt( m.offsetX * m.offsetX + m.offsetY * m.offsetY );
+    }
+
+    constexpr LegGeometry geometry( const Mount& m, double c, double s, double l )
+    {
+        return LegGeometry {
+            m.coxaPin, m.femurPin, m.tibiaPin, m.inverted,
+            float( m.offsetX ), float( m.offsetY ),
+            float( c ), float( s ), float( -s ), float( c ),
+            float( -m.offsetY / l ), float( m.offsetX / l )
+        };
+    }
+
+    struct Generator
+    {
+        typedef LegGeometry Type;
+        static const int SIZE = NUM_LEGS;
+
+        static constexpr LegGeometry value( int i )
+        {
+            return geometry( MOUNTS[i],
+                             const_cos( const_radians( MOUNTS[i].angle ) ),
+                             const_sin( const_radians( MOUNTS[i].angle ) ),
+                             length( MOUNTS[i] ) );
+        }
+    };
+}
+
+// flash address of the leg geometry
+inline const LegGeometry& legGeometry( int index )
+{
+    return StaticTable< LegMounts::Generator >::data[index];
+}
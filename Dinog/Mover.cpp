@@ -17,10 +17,7 @@ void Mover::init()
 #ifdef DEBUG_TRACE
     Serial.println( "Initialize Mover" );
 #endif
-    for( int i = 0; i < NUM_LEGS; ++i )
-    {
-        m_legs[i].init( Leg::getConfig( i ) );
-    }
+    m_legs.init();
 }
 
 void Mover::setControl( const Control& control )
@@ -44,15 +41,9 @@ void Mover::update( float dt )
                 
         m_time += gaitTimeGradient * velTimeGradient;
 
-        Vec3f locomotionVector {};
-        float elevation {};
-
-        for( int i = 0; i < NUM_LEGS; ++i )
-        {
-            m_solver.evaluate( i, locomotionVector, elevation );
-            auto ph = gait->evaluate( i, m_time );            
-            m_legs[i].setInput( locomotionVector, elevation, ph );
-        }
+        m_solver.evaluate( m_input );
+        gait->evaluate( m_time, m_input.phase );
+        m_legs.setInput( m_input );
     }
 }
 
@@ -69,11 +60,21 @@ void Mover::evaluateLeg( int leg, const Vec3f& pos )
 {
     if( !m_locomotionEnabled )
     {
-        m_legs[leg].moveToPos( pos );
+        m_legs.moveToPos( leg, pos );
     }
 }
 
 void Mover::centerLeg( int leg )
 {
-    m_legs[leg].centerLeg();
+    m_legs.centerLeg( leg );
+}
+
+unsigned long Mover::getSaturations( int leg ) const
+{
+    return m_legs.getSaturations( leg );
+}
+
+unsigned long Mover::getSlewSaturations( int leg )
+{
+    return m_legs.getSlewSaturations( leg );
 }
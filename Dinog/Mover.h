@@ -17,9 +17,12 @@ public:
     void enableLocomotion( bool enable );
     void evaluateLeg( int leg, const Vec3f& pos );
     void centerLeg( int leg );
+    unsigned long getSaturations( int leg ) const;
+    unsigned long getSlewSaturations( int leg );
 
 private:
-    LegController m_legs[NUM_LEGS];
+    LegController m_legs;
+    LegInput m_input;
     Control m_control;
     float m_time { 0 };
     bool m_locomotionEnabled { false };
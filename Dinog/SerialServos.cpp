@@ -0,0 +1,138 @@
+#include "SerialServos.h"
+#include "Leg.h"
+
+#if SERVO_OUTPUT == SERVO_OUTPUT_SERIAL
+
+// UART of the servo controller, Serial1 is taken by the SBUS receiver
+#define SERIAL_SERVOS_PORT Serial2
+#define SERIAL_SERVOS_BAUD 115200
+
+namespace
+{
+    // same pulse range as ServoEx with default attach()
+    static const float MIN_PULSE = 544;
+    static const float MAX_PULSE = 2400;
+    static const uint16_t MAX_VALUE = 0x3FFF;
+
+    // time a frame takes on the link, 10 bits per byte
+    static const unsigned long FRAME_MICROS = SerialServos::FRAME_SIZE * 10000000UL / SERIAL_SERVOS_BAUD;
+
+    uint16_t targets[SerialServos::NUM_CHANNELS];
+    bool changed = false;
+    unsigned long lastSent = 0;
+    unsigned long lastSentMicros = 0;
+    unsigned long frames = 0;
+    unsigned long held = 0;
+    unsigned long dropped = 0;
+
+    void put14( uint8_t* buffer, int& pos, uint16_t value )
+    {
+        buffer[pos++] = value & 0x7F;
+        buffer[pos++] = ( value >> 7 ) & 0x7F;
+    }
+}
+
+void SerialServos::init()
+{
+    SERIAL_SERVOS_PORT.begin( SERIAL_SERVOS_BAUD );
+    for( int i = 0; i < NUM_CHANNELS; ++i )
+    {
+        targets[i] = ( uint16_t ) ( ( MIN_PULSE + MAX_PULSE ) * 2 );
+    }
+    lastSent = millis();
+    lastSentMicros = micros() - FRAME_MICROS;
+}
+
+void SerialServos::write( int channel, float value )
+{
+    if( channel < 0 || channel >= NUM_CHANNELS )
+        return;
+
+    value = constrain( value, 0.0f, 180.0f );
+    float pulse = MIN_PULSE + value * ( MAX_PULSE - MIN_PULSE ) / 180.0f;
+    uint16_t target = ( uint16_t ) ( pulse * 4 + 0.5f );
+
+    if( targets[channel] != target )
+    {
+        targets[channel] = target;
+        changed = true;
+    }
+}
+
+bool SerialServos::send()
+{
+    if( !changed )
+        return true;
+
+    if( micros() - lastSentMicros < FRAME_MICROS )
+    {
+        // the link is still busy with the last frame, a later send carries the latest targets
+        ++held;
+        return false;
+    }
+
+    if( SERIAL_SERVOS_PORT.availableForWrite() < FRAME_SIZE )
+    {
+        // previous frame is still being transmitted, the next tick sends the latest targets
+        ++dropped;
+        return false;
+    }
+
+    unsigned long now = millis();
+    unsigned long moveTime = now - lastSent;
+    if( moveTime > MAX_VALUE )
+        moveTime = MAX_VALUE;
+
+    uint8_t frame[FRAME_SIZE];
+    int pos = 0;
+    frame[pos++] = COMMAND;
+    frame[pos++] = NUM_CHANNELS;
+    put14( frame, pos, moveTime );
+    for( int i = 0; i < NUM_CHANNELS; ++i )
+    {
+        put14( frame, pos, targets[i] );
+    }
+    uint8_t checksum = 0;
+    for( int i = 0; i < pos; ++i )
+    {
+        checksum += frame[i];
+    }
+    frame[pos++] = checksum & 0x7F;
+
+    SERIAL_SERVOS_PORT.write( frame, pos );
+
+    lastSent = now;
+    lastSentMicros = micros();
+    changed = false;
+    ++frames;
+    return true;
+}
+
+unsigned long SerialServos::getFrames()
+{
+    return frames;
+}
+
+unsigned long SerialServos::getHeld()
+{
+    return held;
+}
+
+unsigned long SerialServos::getDropped()
+{
+    return dropped;
+}
+
+void SerialServos::printStats()
+{
+#ifdef DEBUG_TRACE
+    Serial.print( "Servo frames: " );
+    Serial.print( frames );
+    Serial.print( " held: " );
+    Serial.print( held );
+    Serial.print( " dropped: " );
+    Serial.println( dropped );
+#endif
+}
+
+#endif
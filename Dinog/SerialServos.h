@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Output backend for an external servo controller on a UART ( SERVO_OUTPUT_SERIAL in Leg.h )
+//
+// Targets of all channels are collected during a control tick and sent as one binary frame,
+// data bytes carry 7 bits like the Pololu Maestro protocol, so the command byte is the only one
+// with the most significant bit set and the receiver can resynchronize on it:
+//
+//     0xC5                  command
+//     count                 number of channels, starting at channel 0
+//     time low, time high   group move time in ms, 14 bit: all channels arrive together
+//     target low, high      per channel, pulse width in quarter microseconds, 14 bit
+//     checksum              7 bit sum of all preceding bytes
+//
+// A frame of 18 channels takes 41 bytes, 3.6 ms at 115200 baud.  The control loop runs every millisecond,
+// so send() holds the targets until the link has carried the last frame and sends the latest ones then
+class SerialServos
+{
+public:
+    static const int NUM_CHANNELS = 18;
+    static const uint8_t COMMAND = 0xC5;
+    static const int FRAME_SIZE = 5 + 2 * NUM_CHANNELS;
+
+    static void init();
+
+    // servo degrees 0..180 are mapped onto the pulse range the same way ServoEx::write does,
+    // fractional degrees are kept
+    static void write( int channel, float value );
+
+    // sends the targets written since the last frame, the move time is the time since the last frame
+    // returns false and keeps the targets for a later send while the last frame is still on the link,
+    // returns false and drops the frame if the UART buffer can not take it without blocking ( other output on the port )
+    static bool send();
+
+    static unsigned long getFrames();
+    static unsigned long getHeld();
+    static unsigned long getDropped();
+    // frames, held and dropped sends with DEBUG_TRACE
+    static void printStats();
+};
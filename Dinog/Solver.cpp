@@ -1,5 +1,5 @@
 #include "Solver.h"
-#include "Leg.h"
+#include "LegGeometry.h"
 
 #include <Arduino.h>
 #include <MathUtils.h>
@@ -9,21 +9,14 @@ namespace
     const float MAX_ABS_ELEVATION = 35.0f;
     const float MAX_ABS_LOCOMOTION = 60.0f;
 
-    float evaluateElevation( const Vec3f& offset, const Vec3f& N, float baseH )
+    float evaluateElevation( float offsetX, float offsetY, const Vec3f& N, float baseH )
     {
-        return baseH - ( N[0] * offset[0] + N[1] * offset[1] ) / N[2];
+        return baseH - ( N[0] * offsetX + N[1] * offsetY ) / N[2];
     }
 }
 
 Solver::Solver()
 {
-    // tangent vectors for each leg
-    for( int i = 0; i < NUM_LEGS; ++i )
-    {
-        auto R = Leg::getConfig( i ).offset;
-        R.normalize();
-        m_tangents[i] = R.cross( - Vec3f::Z() );
-    }
 }
 
 void Solver::setControl( const Control & control )
@@ -39,25 +32,35 @@ float Solver::getVelocity() const
     return max( fabs(m_direction[0]), max( fabs(m_direction[1]), fabs(m_torque) ) );
 }
 
-void Solver::evaluate( int legIndex, Vec3f& locomotionVector, float& elevation )
+void Solver::evaluate( LegInput& input ) const
 {
-    const auto& lc = Leg::getConfig( legIndex );
+    auto dirX = m_direction[0] * MAX_ABS_LOCOMOTION;
+    auto dirY = m_direction[1] * MAX_ABS_LOCOMOTION;
+    auto torque = fabs( m_torque ) >= F_TOLERANCE ? m_torque * MAX_ABS_LOCOMOTION : 0.0f;
+    auto baseH = m_elevation * MAX_ABS_ELEVATION;
 
-    if( fabs( m_torque ) >= F_TOLERANCE )
-    {  
-        auto Vt = m_tangents[legIndex] * m_torque * MAX_ABS_LOCOMOTION;
-        locomotionVector = m_direction * MAX_ABS_LOCOMOTION + Vt;
-    }
-    else
+    for( int i = 0; i < NUM_LEGS; ++i )
     {
-        locomotionVector = m_direction * MAX_ABS_LOCOMOTION;
+        const auto& geometry = legGeometry( i );
+        auto x = dirX + pgm_read_float( &geometry.tangentX ) * torque;
+        auto y = dirY + pgm_read_float( &geometry.tangentY ) * torque;
+        auto l2 = x * x + y * y;
+
+        if( l2 > MAX_ABS_LOCOMOTION * MAX_ABS_LOCOMOTION )
+        {
+            auto scale = MAX_ABS_LOCOMOTION / sqrt( l2 );
+            x *= scale;
+            y *= scale;
+        }
+
+        input.locomotionX[i] = x;
+        input.locomotionY[i] = y;
     }
 
-    if( locomotionVector.length2() > MAX_ABS_LOCOMOTION * MAX_ABS_LOCOMOTION )
+    const auto N = Vec3f::Z();
+    for( int i = 0; i < NUM_LEGS; ++i )
     {
-        locomotionVector.normalize();
-        locomotionVector *= MAX_ABS_LOCOMOTION;
+        const auto& geometry = legGeometry( i );
+        input.elevation[i] = evaluateElevation( pgm_read_float( &geometry.offsetX ), pgm_read_float( &geometry.offsetY ), N, baseH );
     }
-
-    elevation = evaluateElevation( lc.offset, Vec3f::Z(), m_elevation * MAX_ABS_ELEVATION );
-}
\ No newline at end of file
+}
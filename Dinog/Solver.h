@@ -10,11 +10,11 @@ public:
 
     void setControl( const Control& control );
     float getVelocity() const;
-    void evaluate( int legIndex, Vec3f& locomotionVector, float& elevation );
+    // fills locomotion vectors and elevations of all legs
+    void evaluate( LegInput& input ) const;
 
 private:
     Vec3f m_direction;
     float m_torque;
     float m_elevation;
-    Vec3f m_tangents[NUM_LEGS] {};
 };
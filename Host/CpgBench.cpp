@@ -0,0 +1,253 @@
+// CpgBench.cpp - Host timing and transition latency of the gait engine, on the Mover::update time law
+//
+// CpgBench             the CPG engine ( GAIT_ENGINE_CPG )
+// CpgBenchSwitching    the same measurements of the switching engine
+//
+// Prints ns per tick ( Gait::query and Gait::evaluate( t, phases ) ) at the steady velocities of wave ( 0.1 ),
+// ripple ( 0.5 ) and tripod ( 1.0 ), then for steps of the velocity:
+//   settled   seconds until the lift offs of all legs stay within PATTERN_TOLERANCE cycles
+//             of the leads the engine keeps at the new velocity
+//   jump      largest step of a leg on the step cycle in one tick after the velocity step,
+//             swing and stance are a half cycle each
+
+#include <Arduino.h>
+
+#include "Gait.h"
+
+#undef min
+#undef max
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+namespace
+{
+    const float VELOCITIES[] = { 0.1f, 0.5f, 1.0f };
+    const int RUNS = 5;
+    // Mover::update at 10 ms
+    const float TICK_S = 0.01f;
+    const int SETTLE_TICKS = 6000;
+    const float PATTERN_TOLERANCE = 0.02f;
+
+    struct Step
+    {
+        float from;
+        float to;
+    };
+
+    const Step STEPS[] = { { 0.1f, 1.0f }, { 1.0f, 0.1f }, { 0.1f, 0.6f }, { 0.6f, 1.0f }, { 1.0f, 0.6f }, { 0.0f, 1.0f } };
+
+    volatile float s_sink;
+
+    double now()
+    {
+        return std::chrono::duration< double, std::nano >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    // position on the step cycle of a phase, swing 0 -> 0.5, stance 0.5 -> 1
+    float cyclePosition( float phase )
+    {
+        return phase < 0 ? -phase * 0.5f : 0.5f + phase * 0.5f;
+    }
+
+    // cycle difference to [-0.5; 0.5)
+    float wrapCycle( float d )
+    {
+        return d - floor( d + 0.5f );
+    }
+
+    // Gait time and Mover::update time law, one query and one evaluate per tick
+    class Rig
+    {
+    public:
+        Rig()
+        {
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                m_phases[i] = 0.5f;
+            }
+        }
+
+        void tick( float velocity )
+        {
+            m_t0 = m_t;
+            m_gait = Gait::query( velocity, m_t );
+            m_t += m_gait->getSpeedMultiplier() * 5.0f * TICK_S * std::max( velocity, 0.1f );
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                m_previous[i] = m_phases[i];
+            }
+            m_gait->evaluate( m_t, m_phases );
+            ++m_ticks;
+        }
+
+        // a leg lifted off during the last tick, the lift off time is searched on the gait of the tick
+        bool liftOff( int leg, float& t ) const
+        {
+            if( m_previous[leg] < 0 || m_phases[leg] >= 0 )
+                return false;
+
+            float a = m_t0, b = m_t;
+            for( int i = 0; i < 24; ++i )
+            {
+                float m = ( a + b ) * 0.5f;
+                if( m_gait->evaluate( leg, m ) < 0 )
+                    b = m;
+                else
+                    a = m;
+            }
+            t = b;
+            return true;
+        }
+
+        float jump() const
+        {
+            float step = 0.0f;
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                float d = fabs( wrapCycle( cyclePosition( m_phases[i] ) - cyclePosition( m_previous[i] ) ) );
+                step = std::max( step, d );
+            }
+            return step;
+        }
+
+        long ticks() const
+        {
+            return m_ticks;
+        }
+
+    private:
+        const Gait* m_gait {};
+        float m_t {};
+        float m_t0 {};
+        float m_phases[NUM_LEGS];
+        float m_previous[NUM_LEGS];
+        long m_ticks {};
+    };
+
+    // Leads of the legs on the cycle of leg 0 from their last lift offs, updated at each lift off of leg 0
+    class PatternProbe
+    {
+    public:
+        // returns true when the leads were updated
+        bool update( const Rig& rig )
+        {
+            bool cycle = false;
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                float t;
+                if( !rig.liftOff( i, t ) )
+                    continue;
+
+                if( i == 0 )
+                {
+                    m_period = m_seen[0] ? t - m_liftOffs[0] : 0.0f;
+                    cycle = m_period > 0;
+                }
+                m_liftOffs[i] = t;
+                m_seen[i] = true;
+            }
+
+            if( !cycle || std::count( m_seen, m_seen + NUM_LEGS, true ) < NUM_LEGS )
+                return false;
+
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                m_leads[i] = wrapCycle( ( m_liftOffs[i] - m_liftOffs[0] ) / m_period );
+            }
+            return true;
+        }
+
+        float error( const PatternProbe& target ) const
+        {
+            float error = 0.0f;
+            for( int i = 0; i < NUM_LEGS; ++i )
+            {
+                error = std::max( error, float( fabs( wrapCycle( m_leads[i] - target.m_leads[i] ) ) ) );
+            }
+            return error;
+        }
+
+    private:
+        float m_liftOffs[NUM_LEGS] {};
+        bool m_seen[NUM_LEGS] {};
+        float m_period {};
+        float m_leads[NUM_LEGS] {};
+    };
+
+    void benchTick()
+    {
+        Rig rig;
+        for( float velocity : VELOCITIES )
+        {
+            for( int i = 0; i < SETTLE_TICKS; ++i )
+            {
+                rig.tick( velocity );
+            }
+
+            double best = 1e9;
+            for( int r = 0; r < RUNS; ++r )
+            {
+                double start = now();
+                for( int i = 0; i < 200000; ++i )
+                {
+                    rig.tick( velocity );
+                    s_sink = rig.jump();
+                }
+                best = std::min( best, ( now() - start ) / 200000 );
+            }
+            printf( "v %.1f: %.1f ns per tick\n", velocity, best );
+        }
+    }
+
+    void benchLatency()
+    {
+        Rig rig;
+        for( const auto& step : STEPS )
+        {
+            // pattern the engine keeps at the new velocity
+            PatternProbe target;
+            for( int i = 0; i < SETTLE_TICKS; ++i )
+            {
+                rig.tick( step.to );
+                target.update( rig );
+            }
+
+            for( int i = 0; i < SETTLE_TICKS; ++i )
+            {
+                rig.tick( step.from );
+            }
+
+            PatternProbe probe;
+            long start = rig.ticks();
+            long settled = -1;
+            float jump = 0.0f;
+            for( int i = 0; i < SETTLE_TICKS; ++i )
+            {
+                rig.tick( step.to );
+                jump = std::max( jump, rig.jump() );
+
+                if( probe.update( rig ) )
+                {
+                    if( probe.error( target ) > PATTERN_TOLERANCE )
+                        settled = -1;
+                    else if( settled < 0 )
+                        settled = rig.ticks() - start;
+                }
+            }
+
+            if( settled < 0 )
+                printf( "v %.1f -> %.1f: not settled after %.0f s, jump %.2f\n", step.from, step.to, SETTLE_TICKS * TICK_S, jump );
+            else
+                printf( "v %.1f -> %.1f: settled %.2f s, jump %.2f\n", step.from, step.to, settled * TICK_S, jump );
+        }
+    }
+}
+
+int main()
+{
+    benchTick();
+    benchLatency();
+    return 0;
+}
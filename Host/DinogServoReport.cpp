@@ -0,0 +1,110 @@
+// DinogServoReport.cpp - Timer allocation and pulse report of the 18 Dinog joints on the virtual timers
+//
+// Attaches the joint pins of LegGeometry.h in leg order like LegController::init and prints:
+// - timer, frame length and hardware PWM of every servo
+// - the shortest refresh interval each timer accepts with all pulses at 2400 uS, and the overruns of a 2 s run at it
+// - servoHostReport of every joint stepping 400 uS at once at 20 ms, then again with a travel limit of 480 uS
+// Build variants select the scheduler, allocation and stagger, see Makefile
+
+#include <Arduino.h>
+#include <ServoEx.h>
+
+#include "LegGeometry.h"
+
+#include <stdio.h>
+
+namespace
+{
+    const int SERVOS = NUM_LEGS * 3;
+    const int TRAVEL_LIMIT = 480;
+
+    ServoEx servos[SERVOS];
+
+    void writeAll( int us )
+    {
+        for( int i = 0; i < SERVOS; ++i )
+            servos[i].writeMicroseconds( us );
+    }
+
+    void step( int from, int to )
+    {
+        writeAll( from );
+        servoHostRun( 1000000 );
+        servoHostClearTrace();
+        servoHostTrace( true );
+        servoHostRun( 100000 );
+        writeAll( to );
+        servoHostRun( 400000 );
+        servoHostTrace( false );
+        servoHostReport( stdout );
+        servoHostClearTrace();
+    }
+}
+
+int main()
+{
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        const LegGeometry& geometry = legGeometry( i );
+        servos[i * 3].attach( pgm_read_byte( &geometry.coxaPin ) );
+        servos[i * 3 + 1].attach( pgm_read_byte( &geometry.femurPin ) );
+        servos[i * 3 + 2].attach( pgm_read_byte( &geometry.tibiaPin ) );
+    }
+
+    printf( "servo timer frame hardware\n" );
+    for( int i = 0; i < SERVOS; ++i )
+    {
+        printf( "%5d %5d %5u %d\n", i, servos[i].timer(), servos[i].frameLength(),
+#if SERVO_HARDWARE_PWM
+                servos[i].hardware()
+#else
+                0
+#endif
+              );
+    }
+
+    // one representative servo per timer, hardware PWM timers have no frame to shorten
+    int first[_Nbr_16timers];
+    for( int t = 0; t < _Nbr_16timers; ++t )
+        first[t] = -1;
+    for( int i = 0; i < SERVOS; ++i )
+    {
+        int t = servos[i].timer();
+        if( t >= 0 && first[t] < 0 )
+            first[t] = i;
+    }
+
+    writeAll( MAX_PULSE_WIDTH );
+    servoHostRun( 100000 );
+    for( int t = 0; t < _Nbr_16timers; ++t )
+    {
+        if( first[t] < 0 )
+            continue;
+        ServoEx& servo = servos[first[t]];
+        unsigned int interval = MAX_PULSE_WIDTH;
+        while( interval < MAX_REFRESH_INTERVAL && !servo.setRefreshInterval( interval ) )
+            interval++;
+        servoHostRun( 100000 );
+        unsigned int overruns = servo.refreshOverruns();
+        servoHostRun( 2000000 );
+        printf( "timer %d: shortest interval %u uS, %u overruns in 2 s\n", t, interval,
+                servo.refreshOverruns() - overruns );
+    }
+    for( int t = 0; t < _Nbr_16timers; ++t )
+    {
+        if( first[t] >= 0 )
+            servos[first[t]].setRefreshInterval( REFRESH_INTERVAL );
+    }
+
+    printf( "step 1300 -> 1700 uS\n" );
+    step( 1300, 1700 );
+
+    for( int t = 0; t < _Nbr_16timers; ++t )
+    {
+        if( first[t] >= 0 )
+            servos[first[t]].setTravelLimit( TRAVEL_LIMIT );
+    }
+    printf( "step 1700 -> 1300 uS, travel limit %d uS\n", TRAVEL_LIMIT );
+    step( 1700, 1300 );
+    return 0;
+}
@@ -0,0 +1,84 @@
+// DinogSim.cpp - Runs Mover on the virtual timers and prints the servo pulses
+//
+// 6000 control ticks of 20 ms with a new random Control every 300 ticks ( stops every 1200 ),
+// one line per tick with the last pulse width in timer ticks ( 0.5 uS ) of each of the 18 joint pins,
+// in leg order coxa, femur, tibia.  The output is deterministic, compare.sh diffs it between revisions
+
+#include <Arduino.h>
+
+#include "LegGeometry.h"
+#include "Mover.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+    const int TICKS = 6000;
+    const unsigned long TICK_US = 20000;
+    const int PINS = NUM_LEGS * 3;
+
+    float randomUnit()
+    {
+        return ( rand() % 200 - 100 ) / 100.0f;
+    }
+}
+
+int main()
+{
+    uint8_t pins[PINS];
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        const LegGeometry& geometry = legGeometry( i );
+        pins[i * 3] = pgm_read_byte( &geometry.coxaPin );
+        pins[i * 3 + 1] = pgm_read_byte( &geometry.femurPin );
+        pins[i * 3 + 2] = pgm_read_byte( &geometry.tibiaPin );
+    }
+
+    Leg::loadConfig();
+    Mover mover;
+    mover.init();
+    mover.enableLocomotion( true );
+
+    srand( 1 );
+    Control control;
+    uint64_t rise[PINS] = {};
+    unsigned width[PINS] = {};
+    servoHostTrace( true );
+    for( int t = 0; t < TICKS; ++t )
+    {
+        if( t % 300 == 0 )
+        {
+            control.forward = randomUnit();
+            control.right = randomUnit();
+            control.torque = randomUnit() * 0.5f;
+            control.elevation = randomUnit();
+            if( t % 1200 == 0 )
+                control.forward = control.right = control.torque = 0.0f;
+            mover.setControl( control );
+        }
+        mover.update( TICK_US * 1e-6f );
+        servoHostRun( TICK_US );
+
+        size_t count;
+        const servoHostEdge_t* edges = servoHostEdges( &count );
+        for( size_t e = 0; e < count; ++e )
+        {
+            for( int p = 0; p < PINS; ++p )
+            {
+                if( edges[e].pin != pins[p] )
+                    continue;
+                if( edges[e].level )
+                    rise[p] = edges[e].ticks;
+                else if( rise[p] )
+                    width[p] = ( unsigned ) ( edges[e].ticks - rise[p] );
+            }
+        }
+        servoHostClearTrace();
+
+        for( int p = 0; p < PINS; ++p )
+            printf( "%u ", width[p] );
+        printf( "\n" );
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// FastMathTest.cpp - fast_* approximations of Math/MathUtils against libm in double precision
+//
+// Built once per FAST_MATH_PRECISION tier ( see Makefile ).  Sweeps
+// - fast_sqrt over [0; 1000] and on a geometric sweep up to 1e9, relative error
+// - fast_atan2 over all directions and magnitudes from 1e-3 to 1e6
+// - fast_acos over [-1; 1]
+// - fast_sincos over [-2 pi; 2 pi], the larger error of sine and cosine
+// and fails if an error exceeds the bound of the tier documented in MathUtils.h
+
+#include <MathUtils.h>
+
+#include "HostTest.h"
+
+#include <math.h>
+#include <stdio.h>
+
+namespace
+{
+    // bounds of MathUtils.h: sqrt ( relative ), atan2, acos, sincos
+#if FAST_MATH_PRECISION == FAST_MATH_LOW
+    const char* const NAME = "LOW";
+    const double MAX_ERROR[4] = { 1.8e-3, 3.8e-3, 5.9e-3, 2.5e-3 };
+#elif FAST_MATH_PRECISION == FAST_MATH_MEDIUM
+    const char* const NAME = "MEDIUM";
+    const double MAX_ERROR[4] = { 4.8e-6, 1.2e-5, 7.5e-5, 3.7e-5 };
+#else
+    const char* const NAME = "HIGH";
+    const double MAX_ERROR[4] = { 2.1e-7, 3.1e-7, 5.3e-7, 4.3e-7 };
+#endif
+
+    void check( const char* name, double worst, double bound )
+    {
+        printf( "%s: max error %.2e, bound %.1e\n", name, worst, bound );
+        HOST_CHECK( worst <= bound );
+    }
+
+    double sqrtError( float x )
+    {
+        double exact = sqrt( ( double ) x );
+        return fabs( fast_sqrt( x ) - exact ) / exact;
+    }
+
+    void checkSqrt()
+    {
+        double worst = 0;
+        for( float x = 1e-3f; x <= 1000; x += 1e-3f )
+            worst = fmax( worst, sqrtError( x ) );
+        for( double x = 1e-6; x < 1e9; x *= 1.0001 )
+            worst = fmax( worst, sqrtError( ( float ) x ) );
+        HOST_CHECK( fast_sqrt( 0 ) == 0 && fast_sqrt( -1 ) == 0 );
+        check( "fast_sqrt ( relative )", worst, MAX_ERROR[0] );
+    }
+
+    void checkAtan2()
+    {
+        double worst = 0;
+        for( double r = 1e-3; r < 1e6; r *= 7.7 )
+        {
+            for( int i = 0; i < 100000; ++i )
+            {
+                double a = ( i - 50000 ) * M_PI / 50000 + 1e-6;
+                float x = r * cos( a ), y = r * sin( a );
+                double error = fabs( fast_atan2( y, x ) - atan2( ( double ) y, ( double ) x ) );
+                // +-pi is the same direction
+                worst = fmax( worst, fmin( error, fabs( error - 2 * M_PI ) ) );
+            }
+        }
+        check( "fast_atan2", worst, MAX_ERROR[1] );
+    }
+
+    void checkAcos()
+    {
+        double worst = 0;
+        for( int i = 0; i <= 2000000; ++i )
+        {
+            float x = ( i - 1000000 ) / 1e6f;
+            worst = fmax( worst, fabs( fast_acos( x ) - acos( ( double ) x ) ) );
+        }
+        HOST_CHECK( fast_acos( 1.5f ) == 0 && fast_acos( -1.5f ) == float( M_PI ) );
+        check( "fast_acos", worst, MAX_ERROR[2] );
+    }
+
+    void checkSincos()
+    {
+        double worst = 0;
+        for( int i = 0; i <= 2000000; ++i )
+        {
+            float x = ( i - 1000000 ) * float( 2 * M_PI ) / 1e6f;
+            float s, c;
+            fast_sincos( x, s, c );
+            worst = fmax( worst, fmax( fabs( s - sin( ( double ) x ) ), fabs( c - cos( ( double ) x ) ) ) );
+        }
+        check( "fast_sincos", worst, MAX_ERROR[3] );
+    }
+}
+
+int main()
+{
+    printf( "FAST_MATH_PRECISION %s\n", NAME );
+    checkSqrt();
+    checkAtan2();
+    checkAcos();
+    checkSincos();
+    return hostTestResult( "FastMathTest" );
+}
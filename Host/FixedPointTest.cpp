@@ -0,0 +1,116 @@
+// FixedPointTest.cpp - Math/FixedPoint against libm
+//
+// Built without the Arduino stand-ins, FixedPoint.cpp only needs Pgmspace.h.
+// - isqrt32 rounds to nearest over a dense sweep and at the ends of the range
+// - isqrt_mul32 stays within its 2^-14 relative error bound
+// - atan2_fx stays within 0.001 degree over all directions and magnitudes
+// and prints the cost of each function next to the float function it replaces
+
+#include <FixedPoint.h>
+
+#include "HostTest.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace
+{
+    volatile uint32_t s_sinkU;
+    volatile int32_t s_sinkI;
+    volatile float s_sinkF;
+
+    void checkSqrt()
+    {
+        unsigned long errors = 0;
+        for( uint64_t v = 0; v <= 0xFFFFFFFFULL; v += v < 100000 ? 1 : v / 50000 )
+        {
+            uint32_t expected = ( uint32_t ) llround( sqrt( ( double ) v ) );
+            if( isqrt32( ( uint32_t ) v ) != expected )
+                ++errors;
+        }
+        HOST_CHECK( errors == 0 );
+        HOST_CHECK( isqrt32( 0xFFFFFFFFUL ) == 65536 );
+    }
+
+    void checkSqrtMul()
+    {
+        double worst = 0;
+        for( double a = 1; a < 4e9; a *= 1.37 )
+        {
+            for( double b = 1; b < 4e9; b *= 1.61 )
+            {
+                if( a * b >= 1.8e19 )
+                    continue;
+                uint32_t ia = ( uint32_t ) a, ib = ( uint32_t ) b;
+                double exact = sqrt( ( double ) ia * ib );
+                double error = fabs( isqrt_mul32( ia, ib ) - exact ) / exact;
+                // the result is an integer, rounding adds up to 0.5
+                if( exact > 1e5 && error > worst )
+                    worst = error;
+            }
+        }
+        printf( "isqrt_mul32: max relative error %.2e\n", worst );
+        HOST_CHECK( worst < 1.0 / ( 1 << 14 ) );
+    }
+
+    void checkAtan2()
+    {
+        double worst = 0;
+        for( double r = 1; r < 1e9; r *= 3.3 )
+        {
+            for( int i = 0; i < 3600; ++i )
+            {
+                double a = ( i - 1800 ) * M_PI / 1800 + 1e-4;
+                int32_t x = ( int32_t ) lround( r * cos( a ) );
+                int32_t y = ( int32_t ) lround( r * sin( a ) );
+                if( !x && !y )
+                    continue;
+                double exact = atan2( ( double ) y, ( double ) x ) * 180 / M_PI;
+                double error = fabs( atan2_fx( y, x ) / ( double ) FX_ANGLE_ONE - exact );
+                if( error > 180 )
+                    error = fabs( error - 360 );  // +-180 is the same direction
+                if( error > worst )
+                    worst = error;
+            }
+        }
+        printf( "atan2_fx: max error %.5f deg\n", worst );
+        HOST_CHECK( worst < 0.001 );
+    }
+
+    void cost()
+    {
+        const int N = 1000000;
+        unsigned long long start = hostCycles();
+        for( int i = 0; i < N; ++i )
+            s_sinkU = isqrt32( ( uint32_t ) i * 4099u );
+        unsigned long long fixedSqrt = hostCycles() - start;
+
+        start = hostCycles();
+        for( int i = 0; i < N; ++i )
+            s_sinkF = sqrtf( ( float ) ( ( uint32_t ) i * 4099u ) );
+        unsigned long long floatSqrt = hostCycles() - start;
+
+        start = hostCycles();
+        for( int i = 0; i < N; ++i )
+            s_sinkI = atan2_fx( i - N / 2, 40000 - i / 16 );
+        unsigned long long fixedAtan = hostCycles() - start;
+
+        start = hostCycles();
+        for( int i = 0; i < N; ++i )
+            s_sinkF = atan2f( ( float ) ( i - N / 2 ), ( float ) ( 40000 - i / 16 ) );
+        unsigned long long floatAtan = hostCycles() - start;
+
+        printf( "host %s per call: isqrt32 %.1f, sqrtf %.1f, atan2_fx %.1f, atan2f %.1f\n", HOST_CYCLES_UNIT,
+                ( double ) fixedSqrt / N, ( double ) floatSqrt / N, ( double ) fixedAtan / N, ( double ) floatAtan / N );
+    }
+}
+
+int main()
+{
+    checkSqrt();
+    checkSqrtMul();
+    checkAtan2();
+    cost();
+    return hostTestResult( "FixedPointTest" );
+}
@@ -0,0 +1,138 @@
+// GaitBench.cpp - Host timing of the gait state machine and the line segment curves
+//
+// GaitBench          prints ns per Gait::evaluate( t, phases ) and per Gait::query at the steady velocities of
+//                    wave ( 0.1 ), ripple ( 0.5 ) and tripod ( 1.0 ), and ns per Polyline::evaluate of one leg
+// GaitBench phases   prints the phases of all legs at 20000 times per velocity instead, compare.sh diffs them
+
+#include <Arduino.h>
+#include <LineSegment.h>
+
+#include "Gait.h"
+
+#undef min
+#undef max
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    const float VELOCITIES[] = { 0.1f, 0.5f, 1.0f };
+    const int RUNS = 5;
+
+    volatile float s_sink;
+
+    double now()
+    {
+        return std::chrono::duration< double, std::nano >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    // settles the state machine on the gait of the velocity
+    const Gait* settle( float velocity, float& t )
+    {
+        const Gait* gait = nullptr;
+        for( int i = 0; i < 2000; ++i )
+        {
+            t += 0.01f;
+            gait = Gait::query( velocity, t );
+        }
+        return gait;
+    }
+
+    void printPhases()
+    {
+        float t = 0.0f;
+        float phases[NUM_LEGS];
+        for( float velocity : VELOCITIES )
+        {
+            const Gait* gait = settle( velocity, t );
+            for( int i = 0; i < 20000; ++i )
+            {
+                gait->evaluate( t + i * 0.0037f, phases );
+                for( int l = 0; l < NUM_LEGS; ++l )
+                    printf( "%.7f ", phases[l] );
+                printf( "\n" );
+            }
+        }
+    }
+
+    void benchGait()
+    {
+        float t = 0.0f;
+        float phases[NUM_LEGS];
+        for( float velocity : VELOCITIES )
+        {
+            const Gait* gait = settle( velocity, t );
+            double evaluate = 1e9, query = 1e9;
+            for( int r = 0; r < RUNS; ++r )
+            {
+                double start = now();
+                for( int i = 0; i < 400000; ++i )
+                {
+                    gait->evaluate( t + i * 0.0037f + r, phases );
+                    s_sink = phases[i % NUM_LEGS];
+                }
+                double end = now();
+                evaluate = std::min( evaluate, ( end - start ) / 400000 );
+
+                start = now();
+                for( int i = 0; i < 400000; ++i )
+                {
+                    t += 0.0001f;
+                    s_sink = Gait::query( velocity, t )->getSpeedMultiplier();
+                }
+                end = now();
+                query = std::min( query, ( end - start ) / 400000 );
+            }
+            printf( "v %.1f: %.1f ns per evaluate( t, phases ), %.1f ns per query\n", velocity, evaluate, query );
+        }
+    }
+
+    // two segments per leg as the gait mixer builds them
+    void benchPolyline()
+    {
+        typedef Polyline< float, 4 > Curve;
+        Curve curves[NUM_LEGS];
+        const float t0 = 1000.0f, t1 = 1002.0f;
+        for( int i = 0; i < NUM_LEGS; ++i )
+        {
+            float tm = t0 + ( i + 1 ) * 0.25f;
+            curves[i].pushSegment( LineSegment< float >( -0.3f + i * 0.01f, -1.0f, t0, tm ) );
+            LineSegment< float > segment( 0.25f, 0.3f, t1 );
+            segment.setTrim( tm, t1 );
+            curves[i].pushSegment( segment );
+        }
+
+        double best = 1e9;
+        for( int r = 0; r < RUNS * 4; ++r )
+        {
+            double start = now();
+            for( int k = 0; k < 20000; ++k )
+            {
+                float t = t0 + ( k % 2000 ) * 0.001f;
+                for( int i = 0; i < NUM_LEGS; ++i )
+                {
+                    float value = 0.0f;
+                    curves[i].evaluate( t, value );
+                    s_sink = value;
+                }
+            }
+            best = std::min( best, ( now() - start ) / ( 20000 * NUM_LEGS ) );
+        }
+        printf( "Polyline: %u bytes per segment, %u per curve, %.2f ns per leg evaluate\n",
+                ( unsigned ) sizeof( LineSegment< float > ), ( unsigned ) sizeof( Curve ), best );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 && !strcmp( argv[1], "phases" ) )
+    {
+        printPhases();
+        return 0;
+    }
+    benchGait();
+    benchPolyline();
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Minimal checks for the host tests: a failed check prints its location and the test exits non-zero
+
+#include <stdio.h>
+
+static int hostTestFailures = 0;
+
+#define HOST_CHECK( condition ) \
+    do { \
+        if( !( condition ) ) \
+        { \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition ); \
+            ++hostTestFailures; \
+        } \
+    } while( 0 )
+
+// prints the result, returns the exit code of the test
+inline int hostTestResult( const char* name )
+{
+    printf( "%s: %s\n", name, hostTestFailures ? "FAILED" : "passed" );
+    return hostTestFailures ? 1 : 0;
+}
+
+// time stamp counter on x86, nanoseconds elsewhere, for relative cost comparisons
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define HOST_CYCLES_UNIT "TSC cycles"
+inline unsigned long long hostCycles()
+{
+    return __rdtsc();
+}
+#else
+#include <chrono>
+#define HOST_CYCLES_UNIT "ns"
+inline unsigned long long hostCycles()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+#endif
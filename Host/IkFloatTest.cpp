@@ -0,0 +1,199 @@
+// IkFloatTest.cpp - Float IK kernel of Leg.cpp against the closed form in double precision
+//
+// Leg.cpp is compiled into this file to reach its kernel, IK_INCREMENTAL and USE_FAST_MATH come from the build
+// ( see Makefile ).  Every leg follows a walking trajectory shaped like LegController's: stance lines and swing
+// arcs through the leg center for random locomotion vectors, elevations and step rates, projected onto the
+// workspace as Leg::setPos does.  With IK_INCREMENTAL one foot then moves out to the stretched leg beyond the
+// workspace.  Fails if a joint angle deviates from the closed form by more than the bound documented in Leg.cpp,
+// or, with IK_INCREMENTAL, if a fallback to the closed form ( large step, singular leg, residual ) was never
+// taken.  Prints how many solutions took each path
+
+#include "Leg.cpp"
+
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+#if IK_INCREMENTAL
+    const char* const NAME = "incremental";
+    // see IK_MAX_ERROR
+    const double MAX_ERROR = 0.2;
+#elif USE_FAST_MATH
+    const char* const NAME = "fast math closed form";
+    // see USE_FAST_MATH
+    const double MAX_ERROR = FAST_MATH_PRECISION == FAST_MATH_LOW ? 0.6 : FAST_MATH_PRECISION == FAST_MATH_MEDIUM ? 0.01 : 0.001;
+#else
+    const char* const NAME = "closed form";
+    const double MAX_ERROR = 0.001;
+#endif
+
+    // trajectory of LegController::setInput
+    const float SWING_ELEVATION = 37.0f;
+    const float MAX_LOCOMOTION = 60.0f;
+    const float MAX_ELEVATION = 35.0f;
+    const int PATTERNS = 400;
+    const int CYCLES = 4;
+    // ticks per step cycle, tripod at 10 ms down to a slow wave
+    const int CYCLE_TICKS[] = { 12, 20, 40, 120 };
+
+    double worst[3] = {};
+    unsigned long samples = 0;
+
+    float randomUnit()
+    {
+        return ( rand() % 2001 - 1000 ) / 1000.0f;
+    }
+
+    // joint angles in degrees before inversion and trims
+    void reference( const Vec3f& pos, double angles[3] )
+    {
+        double P0 = sqrt( ( double ) pos[0] * pos[0] + ( double ) pos[1] * pos[1] );
+        double D = P0 - Leg::Config::L1;
+        double L4_2 = D * D + ( double ) pos[2] * pos[2];
+        double L4 = sqrt( L4_2 );
+
+        angles[0] = degrees( atan( -pos[1] / ( double ) pos[0] ) );
+        angles[1] = degrees( acos( ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * L4 ) ) + atan( pos[2] / D ) );
+        angles[2] = degrees( acos( ( L4_2 - L2_2 - L3_2 ) / ( 2 * Leg::Config::L2 * Leg::Config::L3 ) ) );
+    }
+
+    class Foot
+    {
+    public:
+        Foot()
+        {
+#if IK_INCREMENTAL
+            m_ik.valid = false;
+#endif
+        }
+
+        // solves pos as Leg::setPos does, returns false if a joint is off the closed form
+        bool moveTo( Vec3f pos )
+        {
+            clampToWorkspace( pos );
+            return solve( pos );
+        }
+
+        // solves pos without the workspace limits
+        bool solve( const Vec3f& pos )
+        {
+            Joints joints;
+#if IK_INCREMENTAL
+            evaluate( pos, m_ik, joints );
+#else
+            evaluate( pos, joints );
+#endif
+            double expected[3];
+            reference( pos, expected );
+            double angles[3] = { degrees( joints.coxa ), degrees( joints.femur ), degrees( joints.tibia ) };
+
+            bool ok = true;
+            for( int j = 0; j < 3; ++j )
+            {
+                double error = fabs( angles[j] - expected[j] );
+                if( error > worst[j] )
+                    worst[j] = error;
+                // NaN fails as well
+                if( !( error <= MAX_ERROR ) )
+                {
+                    fprintf( stderr, "joint %d at %.2f %.2f %.2f: %.4f deg, closed form %.4f\n", j,
+                             pos[0], pos[1], pos[2], angles[j], expected[j] );
+                    ok = false;
+                }
+            }
+            ++samples;
+            return ok;
+        }
+
+    private:
+#if IK_INCREMENTAL
+        Leg::IkState m_ik;
+#endif
+    };
+
+    // stance from p0 to p1 for phase 0 -> 1, swing from p1 back to p0 over the elevated middle for -1 -> 0
+    Vec3f stepPosition( const Vec3f& p0, const Vec3f& p1, float phase )
+    {
+        if( phase >= 0 )
+            return p0 + ( p1 - p0 ) * phase;
+
+        phase = -phase;
+        auto midZ = p0[2] + SWING_ELEVATION;
+        return Vec3f( lerp( p1[0], p0[0], phase ),
+                      lerp( p1[1], p0[1], phase ),
+                      phase < 0.5f ? lerp( p1[2], midZ, phase ) : lerp( midZ, p0[2], phase ) );
+    }
+
+    bool walk( Foot& foot )
+    {
+        bool ok = true;
+        for( int p = 0; p < PATTERNS; ++p )
+        {
+            float locomotion = MAX_LOCOMOTION * fabs( randomUnit() );
+            float direction = randomUnit() * M_PI;
+            Vec3f half( cos( direction ) * locomotion * 0.5f, sin( direction ) * locomotion * 0.5f, 0 );
+            Vec3f center = CENTER - Vec3f( 0, 0, MAX_ELEVATION * randomUnit() );
+            Vec3f p0 = center + half;
+            Vec3f p1 = center - half;
+            int ticks = CYCLE_TICKS[rand() % ( sizeof( CYCLE_TICKS ) / sizeof( CYCLE_TICKS[0] ) )];
+
+            for( int t = 0; t < CYCLES * ticks; ++t )
+            {
+                float cycle = float( t % ticks ) / ticks;
+                float phase = cycle < 0.5f ? cycle * 2 : ( cycle - 1 ) * 2;
+                ok = foot.moveTo( stepPosition( p0, p1, phase ) ) && ok;
+            }
+        }
+        return ok;
+    }
+
+#if IK_INCREMENTAL
+    // straight out to the stretched leg in small steps, past the tibia limit of the workspace
+    bool stretch( Foot& foot )
+    {
+        bool ok = true;
+        const float Z = -10;
+        const float L4_MAX = Leg::Config::L2 + Leg::Config::L3;
+        for( float x = 140; ( x - Leg::Config::L1 ) * ( x - Leg::Config::L1 ) + Z * Z < L4_MAX * L4_MAX; x += 0.05f )
+        {
+            ok = foot.solve( Vec3f( x, 0, Z ) ) && ok;
+        }
+        return ok;
+    }
+#endif
+}
+
+int main()
+{
+    srand( 1 );
+
+    Foot feet[NUM_LEGS];
+    bool ok = true;
+    for( auto& foot : feet )
+    {
+        ok = walk( foot ) && ok;
+    }
+    HOST_CHECK( ok );
+#if IK_INCREMENTAL
+    Foot probe;
+    HOST_CHECK( stretch( probe ) );
+#endif
+
+    printf( "%s kernel, %lu trajectory samples, max error coxa %.4f, femur %.4f, tibia %.4f deg\n", NAME, samples,
+            worst[0], worst[1], worst[2] );
+    for( int j = 0; j < 3; ++j )
+        HOST_CHECK( worst[j] <= MAX_ERROR );
+
+#if IK_INCREMENTAL
+    const auto& stats = Leg::getIkStats();
+    printf( "incremental %lu, closed form %lu ( step %lu, singular %lu, residual %lu )\n", stats.incremental,
+            stats.closedForm, stats.largeStep, stats.singular, stats.residual );
+    HOST_CHECK( stats.largeStep > 0 );
+    HOST_CHECK( stats.singular > 0 );
+    HOST_CHECK( stats.residual > 0 );
+#endif
+    return hostTestResult( "IkFloatTest" );
+}
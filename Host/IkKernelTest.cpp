@@ -0,0 +1,187 @@
+// IkKernelTest.cpp - Integer IK kernels of Leg.cpp against the float kernel
+//
+// Leg.cpp is compiled into this file to reach its kernel, IK_KERNEL comes from the build ( see Makefile ).
+// Sweeps the leg workspace, prints the largest joint angle deviation from the float kernel formulas by
+// conditioning of the knee triangle, how often the integer servo degrees differ, and the cost of one
+// solution of both kernels.  Fails if the deviation exceeds the bounds documented in Leg.cpp
+
+#include "Leg.cpp"
+
+#include "HostTest.h"
+
+#include <stdio.h>
+
+namespace
+{
+    // |cos| of the knee triangle angles where the bounds are documented
+    const float CONDITIONING[] = { 0.99f, 0.999f };
+    const int BANDS = sizeof( CONDITIONING ) / sizeof( CONDITIONING[0] );
+
+#if IK_KERNEL == IK_KERNEL_FIXED_POINT
+    const char* const NAME = "fixed point";
+    const float MIN_L4 = 0;
+    const double MAX_ERROR[3][BANDS] = { { 0.01, 0.01 }, { 0.06, 0.17 }, { 0.06, 0.17 } };
+    const double MIN_INTEGER_MATCH = 0.99;
+    const int MAX_INTEGER_DIFF = 1;
+
+    // joint angles in degrees before inversion and trims
+    void kernelAngles( const Vec3f& pos, double angles[3] )
+    {
+        int32_t coxa, femur, tibia;
+        solve( pos, coxa, femur, tibia );
+        angles[0] = coxa / ( double ) FX_ANGLE_ONE;
+        angles[1] = femur / ( double ) FX_ANGLE_ONE;
+        angles[2] = tibia / ( double ) FX_ANGLE_ONE;
+    }
+#elif IK_KERNEL == IK_KERNEL_TABLE
+    const char* const NAME = "table";
+    // the table clamps L4 below its range
+    const float MIN_L4 = TABLE_L4_MIN;
+    const double MAX_ERROR[3][BANDS] = { { 0.015, 0.015 }, { 0.09, 1.0 }, { 0.14, 1.7 } };
+    const double MIN_INTEGER_MATCH = 0.99;
+    const int MAX_INTEGER_DIFF = 2;
+
+    // joint angles in degrees before inversion and trims
+    void kernelAngles( const Vec3f& pos, double angles[3] )
+    {
+        int32_t coxa, femur, tibia;
+        solve( pos, coxa, femur, tibia );
+        angles[0] = coxa / ( double ) TABLE_ANGLE_ONE;
+        angles[1] = femur / ( double ) TABLE_ANGLE_ONE;
+        angles[2] = tibia / ( double ) TABLE_ANGLE_ONE;
+    }
+#else
+#error IkKernelTest needs an integer kernel
+#endif
+
+    struct Reference
+    {
+        float angles[3];
+        float L4;
+        float cosKnee;
+        float cosTibia;
+    };
+
+    // the float kernel, without fast math
+    void reference( const Vec3f& pos, Reference& ref )
+    {
+        float P0 = sqrtf( pos[0] * pos[0] + pos[1] * pos[1] );
+        float D = P0 - Leg::Config::L1;
+        float L4_2 = D * D + pos[2] * pos[2];
+        ref.L4 = sqrtf( L4_2 );
+
+        ref.cosKnee = ( L2_2 + L4_2 - L3_2 ) / ( 2 * Leg::Config::L2 * ref.L4 );
+        ref.cosTibia = ( L4_2 - L2_2 - L3_2 ) / ( 2 * Leg::Config::L2 * Leg::Config::L3 );
+        ref.angles[0] = degrees( atanf( -pos[1] / pos[0] ) );
+        ref.angles[1] = degrees( acosf( ref.cosKnee ) + atanf( pos[2] / D ) );
+        ref.angles[2] = degrees( acosf( ref.cosTibia ) );
+    }
+
+    // servo degrees of the float kernel with USE_SERVO_TICKS 0
+    void referenceServo( const Reference& ref, const Leg::Config& config, bool inverted, int values[3] )
+    {
+        values[0] = ref.angles[0] + config.coxaTrim;
+        values[1] = ( inverted ? -ref.angles[1] : ref.angles[1] ) + config.femurTrim;
+        values[2] = ( inverted ? 180 - ref.angles[2] : ref.angles[2] ) + config.tibiaTrim;
+    }
+
+    volatile int s_sink;
+
+    void cost( const Leg::Config& config )
+    {
+        const int N = 200000;
+        unsigned long long kernel = 0, floatKernel = 0;
+        for( int i = 0; i < N; ++i )
+        {
+            Vec3f pos( 60.0f + ( i % 61 ), -40.0f + ( i % 83 ), -100.0f + ( i % 71 ) );
+            int c, f, t;
+            unsigned long long start = hostCycles();
+            evaluate( pos, config, false, c, f, t );
+            unsigned long long middle = hostCycles();
+            Reference ref;
+            reference( pos, ref );
+            int values[3];
+            referenceServo( ref, config, false, values );
+            floatKernel += hostCycles() - middle;
+            kernel += middle - start;
+            s_sink = c + f + t + values[0] + values[1] + values[2];
+        }
+        printf( "host %s per leg solution: %s %.0f, float %.0f\n", HOST_CYCLES_UNIT, NAME,
+                ( double ) kernel / N, ( double ) floatKernel / N );
+    }
+}
+
+int main()
+{
+    const Leg::Config& config = s_config[0];
+    double worst[3][BANDS] = {};
+    unsigned long samples = 0, outOfRange = 0, integerDiffs = 0;
+    int largestIntegerDiff = 0;
+
+    for( float x = 30; x <= 170; x += 1.3f )
+    {
+        for( float y = -90; y <= 90; y += 1.7f )
+        {
+            for( float z = -130; z <= 10; z += 1.1f )
+            {
+                Vec3f pos( x, y, z );
+                Reference ref;
+                reference( pos, ref );
+                float conditioning = max( fabs( ref.cosKnee ), fabs( ref.cosTibia ) );
+                if( !( conditioning <= CONDITIONING[BANDS - 1] ) )
+                    continue;
+                if( ref.L4 < MIN_L4 )
+                {
+                    ++outOfRange;
+                    continue;
+                }
+
+                double angles[3];
+                kernelAngles( pos, angles );
+                for( int j = 0; j < 3; ++j )
+                {
+                    double error = fabs( angles[j] - ref.angles[j] );
+                    for( int b = 0; b < BANDS; ++b )
+                    {
+                        if( conditioning <= CONDITIONING[b] && error > worst[j][b] )
+                            worst[j][b] = error;
+                    }
+                }
+
+                for( int inverted = 0; inverted < 2; ++inverted )
+                {
+                    int values[3], expected[3];
+                    evaluate( pos, config, inverted, values[0], values[1], values[2] );
+                    referenceServo( ref, config, inverted, expected );
+                    for( int j = 0; j < 3; ++j )
+                    {
+                        int diff = abs( values[j] - expected[j] );
+                        if( diff )
+                            ++integerDiffs;
+                        largestIntegerDiff = max( largestIntegerDiff, diff );
+                    }
+                }
+                ++samples;
+            }
+        }
+    }
+
+    double match = 1.0 - integerDiffs / ( 6.0 * samples );
+    printf( "%s kernel, %lu workspace samples", NAME, samples );
+    if( outOfRange )
+        printf( ", %lu more with L4 < %.0f skipped", outOfRange, MIN_L4 );
+    printf( "\n" );
+    for( int b = 0; b < BANDS; ++b )
+    {
+        printf( "|cos| <= %.3f: max error coxa %.4f, femur %.4f, tibia %.4f deg\n", CONDITIONING[b],
+                worst[0][b], worst[1][b], worst[2][b] );
+        for( int j = 0; j < 3; ++j )
+            HOST_CHECK( worst[j][b] <= MAX_ERROR[j][b] );
+    }
+    printf( "integer servo degrees: %.2f%% match the float kernel, largest difference %d\n", match * 100, largestIntegerDiff );
+    HOST_CHECK( match >= MIN_INTEGER_MATCH );
+    HOST_CHECK( largestIntegerDiff <= MAX_INTEGER_DIFF );
+
+    cost( config );
+    return hostTestResult( "IkKernelTest" );
+}
@@ -0,0 +1,71 @@
+// MoverBench.cpp - Host timing of one Mover::update of all legs
+//
+// Runs the DinogSim control sequence for 3000 ticks of 20 ms without the servo timers and prints the mean
+// and the slowest Mover::update of the fastest of 20 runs.  compare.sh prints the result of an older revision next to it, e.g. the
+// per leg updates before the batched ones:  ./compare.sh 50e5925~1 MoverBench
+
+#include <Arduino.h>
+
+#include "Mover.h"
+
+#include "HostTest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+    const int TICKS = 3000;
+    const int RUNS = 20;
+    const float TICK_S = 0.02f;
+
+    float randomUnit()
+    {
+        return ( rand() % 200 - 100 ) / 100.0f;
+    }
+}
+
+int main()
+{
+    Leg::loadConfig();
+
+    // the best of RUNS runs, the first one also warms the caches up
+    double mean = 0;
+    unsigned long long slowest = 0;
+    for( int run = 0; run < RUNS; ++run )
+    {
+        Mover mover;
+        mover.init();
+        mover.enableLocomotion( true );
+
+        srand( 1 );
+        Control control;
+        unsigned long long total = 0, runSlowest = 0;
+        for( int t = 0; t < TICKS; ++t )
+        {
+            if( t % 300 == 0 )
+            {
+                control.forward = randomUnit();
+                control.right = randomUnit();
+                control.torque = randomUnit() * 0.5f;
+                control.elevation = randomUnit();
+                if( t % 1200 == 0 )
+                    control.forward = control.right = control.torque = 0.0f;
+                mover.setControl( control );
+            }
+            unsigned long long start = hostCycles();
+            mover.update( TICK_S );
+            unsigned long long cycles = hostCycles() - start;
+            total += cycles;
+            if( cycles > runSlowest )
+                runSlowest = cycles;
+        }
+        if( run == 0 || ( double ) total / TICKS < mean )
+        {
+            mean = ( double ) total / TICKS;
+            slowest = runSlowest;
+        }
+    }
+    printf( "Mover::update host %s: mean %.0f, slowest %llu\n", HOST_CYCLES_UNIT, mean, slowest );
+    return 0;
+}
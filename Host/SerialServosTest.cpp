@@ -0,0 +1,183 @@
+// SerialServosTest.cpp - Frames of the serial servo output on a pseudo-terminal
+//
+// Serial2 writes to the slave side of a pseudo-terminal, the test reads the master side like the servo
+// controller would.  The control loop runs every millisecond for 2 s and changes every target each time:
+// - every frame has the command byte, 18 channels and a valid checksum
+// - frames follow each other at the link rate: no more than one per 41 bytes at 115200 baud, and
+//   the sends in between are held, not dropped
+// - each frame carries the targets of the send that produced it, its move time is the time since the last frame
+// - with other output queued on the port the frame is dropped and counted, the next send recovers
+
+#include "SerialServos.h"
+
+#include "HostTest.h"
+
+#undef min
+#undef max
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const int CHANNELS = SerialServos::NUM_CHANNELS;
+    const int STEPS = 2000;
+    const unsigned long LINK_MICROS = SerialServos::FRAME_SIZE * 10000000UL / 115200;
+
+    struct Targets
+    {
+        uint16_t values[CHANNELS];
+        unsigned long ms;
+    };
+
+    int s_master = -1;
+    std::vector< uint8_t > s_received;
+
+    bool openLink()
+    {
+        s_master = posix_openpt( O_RDWR | O_NOCTTY );
+        if( s_master < 0 || grantpt( s_master ) || unlockpt( s_master ) )
+            return false;
+        int slave = open( ptsname( s_master ), O_RDWR | O_NOCTTY );
+        if( slave < 0 )
+            return false;
+        termios raw;
+        tcgetattr( slave, &raw );
+        cfmakeraw( &raw );
+        tcsetattr( slave, TCSANOW, &raw );
+        fcntl( s_master, F_SETFL, O_NONBLOCK );
+        Serial2.setOutput( slave );
+        return true;
+    }
+
+    void receive()
+    {
+        uint8_t buffer[256];
+        ssize_t n;
+        while( ( n = read( s_master, buffer, sizeof( buffer ) ) ) > 0 )
+            s_received.insert( s_received.end(), buffer, buffer + n );
+    }
+
+    float degreesOf( int step, int channel )
+    {
+        return ( step * 7 + channel * 10 ) % 1800 / 10.0f;
+    }
+
+    // the quarter microseconds SerialServos::write makes of the degrees
+    uint16_t expected( float value )
+    {
+        return ( uint16_t ) ( ( 544 + value * ( 2400 - 544 ) / 180.0f ) * 4 + 0.5f );
+    }
+
+    // splits the received bytes into frames at the command byte, returns the number of bad frames
+    int decode( std::vector< Targets >& frames )
+    {
+        int bad = 0;
+        size_t pos = 0;
+        while( pos < s_received.size() )
+        {
+            if( s_received[pos] != SerialServos::COMMAND )
+            {
+                ++pos;
+                continue;
+            }
+            if( pos + SerialServos::FRAME_SIZE > s_received.size() )
+                return bad + 1;
+            const uint8_t* frame = &s_received[pos];
+            uint8_t checksum = 0;
+            for( int i = 0; i < SerialServos::FRAME_SIZE - 1; ++i )
+                checksum += frame[i];
+            if( frame[1] != CHANNELS || ( checksum & 0x7F ) != frame[SerialServos::FRAME_SIZE - 1] )
+            {
+                ++bad;
+                ++pos;
+                continue;
+            }
+            Targets targets;
+            targets.ms = frame[2] | frame[3] << 7;
+            for( int i = 0; i < CHANNELS; ++i )
+                targets.values[i] = frame[4 + 2 * i] | frame[5 + 2 * i] << 7;
+            frames.push_back( targets );
+            pos += SerialServos::FRAME_SIZE;
+        }
+        return bad;
+    }
+}
+
+int main()
+{
+    HOST_CHECK( openLink() );
+    if( hostTestFailures )
+        return hostTestResult( "SerialServosTest" );
+
+    SerialServos::init();
+    servoHostRun( 10000 );
+
+    // targets and time of every send that produced a frame
+    std::vector< Targets > sent;
+    unsigned long sends = 0;
+    for( int step = 0; step < STEPS; ++step )
+    {
+        Targets targets;
+        for( int i = 0; i < CHANNELS; ++i )
+        {
+            SerialServos::write( i, degreesOf( step, i ) );
+            targets.values[i] = expected( degreesOf( step, i ) );
+        }
+        targets.ms = millis();
+        ++sends;
+        if( SerialServos::send() )
+            sent.push_back( targets );
+        servoHostRun( 1000 );
+        receive();
+    }
+
+    unsigned long frames = SerialServos::getFrames();
+    printf( "%lu sends in %d ms: %lu frames, %lu held, %lu dropped\n", sends, STEPS, frames,
+            SerialServos::getHeld(), SerialServos::getDropped() );
+    HOST_CHECK( frames == sent.size() );
+    HOST_CHECK( frames + SerialServos::getHeld() == sends );
+    HOST_CHECK( SerialServos::getDropped() == 0 );
+    // one frame per link time, a held send waits for the next loop millisecond at most
+    HOST_CHECK( frames <= STEPS * 1000UL / LINK_MICROS + 1 );
+    HOST_CHECK( frames >= STEPS * 1000UL / ( LINK_MICROS + 1000 ) );
+
+    // other output on the port leaves no room for the frame
+    servoHostRun( LINK_MICROS );
+    uint8_t other[SerialServos::FRAME_SIZE] = {};
+    Serial2.write( other, sizeof( other ) );
+    SerialServos::write( 0, 90.0f );
+    HOST_CHECK( !SerialServos::send() );
+    HOST_CHECK( SerialServos::getDropped() == 1 );
+    servoHostRun( 2 * LINK_MICROS );
+    HOST_CHECK( SerialServos::send() );
+    servoHostRun( LINK_MICROS );
+    receive();
+
+    std::vector< Targets > received;
+    HOST_CHECK( decode( received ) == 0 );
+    HOST_CHECK( received.size() == frames + 1 );
+    size_t compared = received.size() < sent.size() ? received.size() : sent.size();
+    int wrongTargets = 0, wrongTimes = 0;
+    for( size_t f = 0; f < compared; ++f )
+    {
+        for( int i = 0; i < CHANNELS; ++i )
+        {
+            if( received[f].values[i] != sent[f].values[i] )
+            {
+                ++wrongTargets;
+                break;
+            }
+        }
+        if( f > 0 && received[f].ms != sent[f].ms - sent[f - 1].ms )
+            ++wrongTimes;
+    }
+    HOST_CHECK( wrongTargets == 0 );
+    HOST_CHECK( wrongTimes == 0 );
+    if( !received.empty() )
+        HOST_CHECK( received.back().values[0] == expected( 90.0f ) );
+
+    return hostTestResult( "SerialServosTest" );
+}
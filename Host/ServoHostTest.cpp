@@ -0,0 +1,63 @@
+/*
+  ServoHostTest.cpp - Pulse timing of ServoEx on the virtual timers
+
+  18 servos on ISR pins at different widths: every pin pulses at the refresh rate with the written
+  width minus TRIM_DURATION, no frame overruns.  Built once per scheduler, see Makefile.
+  The servos fill the timers, the allocation can not change once they are attached
+*/
+
+#include <ServoHost.h>
+#include <ServoEx.h>
+
+#include "HostTest.h"
+
+static const int SERVOS = 18;
+static const int FIRST_PIN = 22;              // pins 22..39 are no output compare pins
+static const unsigned long RUN_US = 1000000;
+
+int main()
+{
+  ServoEx servos[SERVOS];
+  for( int i = 0; i < SERVOS; i++ ) {
+    servos[i].attach(FIRST_PIN + i);
+    servos[i].writeMicroseconds(1000 + i * 50);
+  }
+
+  servoHostRun(100000);                       // first frames
+  servoHostTrace(true);
+  servoHostRun(RUN_US);
+  servoHostTrace(false);
+
+  size_t count;
+  const servoHostEdge_t *edges = servoHostEdges(&count);
+  for( int i = 0; i < SERVOS; i++ ) {
+    uint8_t pin = FIRST_PIN + i;
+    uint64_t rise = 0, lastRise = 0;
+    unsigned long pulses = 0, badWidths = 0, badPeriods = 0;
+    for( size_t e = 0; e < count; e++ ) {
+      if( edges[e].pin != pin )
+        continue;
+      if( edges[e].level ) {
+        if( lastRise && edges[e].ticks - lastRise != REFRESH_INTERVAL * 2 )
+          badPeriods++;
+        rise = lastRise = edges[e].ticks;
+      }
+      else if( rise ) {
+        if( edges[e].ticks - rise != (uint64_t)(1000 + i * 50 - 2) * 2 )   // TRIM_DURATION of ServoEx.cpp
+          badWidths++;
+        pulses++;
+      }
+    }
+    HOST_CHECK( pulses >= RUN_US / REFRESH_INTERVAL - 1 );
+    HOST_CHECK( badWidths == 0 );
+    HOST_CHECK( badPeriods == 0 );
+    HOST_CHECK( servos[i].refreshOverruns() == 0 );
+    HOST_CHECK( !servos[i].hardware() );
+  }
+  HOST_CHECK( ServoEx::servosPerTimer() == SERVOS_PER_TIMER_MAX );
+  HOST_CHECK( servos[SERVOS_PER_TIMER_MAX - 1].timer() == 0 && servos[SERVOS_PER_TIMER_MAX].timer() == 1 );
+  HOST_CHECK( !ServoEx::allocate(SERVOS, 3) );
+  HOST_CHECK( ServoEx::servosPerTimer() == SERVOS_PER_TIMER_MAX );
+  HOST_CHECK( servoHostWriteVcd(HOST_BUILD "/ServoHostTest.vcd") );
+  return hostTestResult(SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT ? "ServoHostTest concurrent" : "ServoHostTest sequential");
+}
@@ -0,0 +1,83 @@
+// ServoIsrBench.cpp - ISR statistics of the 18 Dinog joints on the virtual timers
+//
+// Attaches the joint pins of LegGeometry.h like DinogServoReport, moves every joint between 1300 and 1700 uS
+// each 20 ms frame and prints per timer the SERVO_STATS of a 2 s run: compare interrupts, their duration
+// in timer ticks ( virtual time, only the ticks the handler waits for ) and the falling edge error histogram.
+// Then the host nanoseconds per interrupt, the fastest of 5 runs.  ServoIsrBenchDigitalWrite is the same
+// with SERVO_PORT_WRITE 0, see Makefile
+
+#include <Arduino.h>
+#include <ServoEx.h>
+
+#include "LegGeometry.h"
+
+#include <stdio.h>
+
+#if !SERVO_STATS
+#error ServoIsrBench needs SERVO_STATS
+#endif
+
+namespace
+{
+    const int SERVOS = NUM_LEGS * 3;
+    const int FRAMES = 100;
+    const int RUNS = 5;
+
+    ServoEx servos[SERVOS];
+
+    // two seconds of frames, the widths swing so every frame moves every joint
+    void run()
+    {
+        for( int f = 0; f < FRAMES; ++f )
+        {
+            for( int i = 0; i < SERVOS; ++i )
+                servos[i].writeMicroseconds( ( f + i ) % 2 ? 1700 : 1300 );
+            servoHostRun( 20000 );
+        }
+    }
+}
+
+int main()
+{
+    // two legs per timer as LegController::init allocates them
+    ServoEx::allocate( SERVOS, 3 );
+    for( int i = 0; i < NUM_LEGS; ++i )
+    {
+        const LegGeometry& geometry = legGeometry( i );
+        servos[i * 3].attach( pgm_read_byte( &geometry.coxaPin ) );
+        servos[i * 3 + 1].attach( pgm_read_byte( &geometry.femurPin ) );
+        servos[i * 3 + 2].attach( pgm_read_byte( &geometry.tibiaPin ) );
+    }
+    servoHostRun( 100000 );
+
+    // the first servo allocated to each timer reads the statistics of the timer
+    for( int i = 0; i < SERVOS; i += ServoEx::servosPerTimer() )
+        servos[i].resetStats();
+    run();
+
+    printf( "timer interrupts isr min/mean/max ticks, edge error 0 1 2-3 4-7 8-15 16-31 32-63 64+ ticks\n" );
+    for( int i = 0; i < SERVOS; i += ServoEx::servosPerTimer() )
+    {
+        servoStats_t stats;
+        servos[i].stats( &stats );
+        printf( "%5d %10lu %4u %5.1f %4u ", i / ServoEx::servosPerTimer(), ( unsigned long ) stats.isrCount, stats.isrMin,
+                stats.isrCount ? ( double ) stats.isrSum / stats.isrCount : 0.0, stats.isrMax );
+        for( int b = 0; b < SERVO_STATS_BINS; ++b )
+            printf( " %u", stats.edgeHistogram[b] );
+        printf( "\n" );
+    }
+
+    double fastest = 0;
+    for( int r = 0; r < RUNS; ++r )
+    {
+        unsigned long count0, count1;
+        uint64_t time0 = servoHostIsrTime( &count0 );
+        run();
+        uint64_t time1 = servoHostIsrTime( &count1 );
+        double ns = ( double ) ( time1 - time0 ) / ( count1 - count0 );
+        if( r == 0 || ns < fastest )
+            fastest = ns;
+    }
+    printf( "host ns per interrupt: %.0f\n", fastest );
+    return 0;
+}
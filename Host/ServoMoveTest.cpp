@@ -0,0 +1,109 @@
+/*
+  ServoMoveTest.cpp - Timed group moves of ServoEx on the virtual timers
+
+  Short and long moves with every ease profile, up and down: the pulse width never steps back, no frame
+  steps further than the steepest part of the profile allows, and the end point is reached by the last
+  frame of the move time.  A 20 s move runs 1000 frames, enough phase steps to wrap a rounded 16 bit step.
+  A timed move begun after its timer latched a ServoFrame runs to its end when the frame is carried over into
+  the next one because another timer has not latched it yet
+*/
+
+#include <ServoHost.h>
+#include <ServoEx.h>
+
+#include "HostTest.h"
+
+static const int PIN = 22;
+static const int OTHER_PIN = 23;                                        // on the next timer
+static const unsigned int MOVE_TIMES[] = { 100, 1000, 20000 };   // ms
+static const uint8_t PROFILES[] = { SERVO_EASE_LINEAR, SERVO_EASE_IN, SERVO_EASE_OUT, SERVO_EASE_IN_OUT };
+static const int SLOPES[] = { 1, 2, 2, 2 };                             // steepest slope of each profile, rounded up
+
+static void checkMove(ServoEx &servo, int from, int to, unsigned int moveTime, int profile)
+{
+  servo.writeMicroseconds(from);
+  servoHostRun(2 * REFRESH_INTERVAL);
+
+  ServoGroupMove.start();
+  servo.writeMicroseconds(to);
+  ServoGroupMove.commit(moveTime, PROFILES[profile]);
+
+  unsigned long frames = (unsigned long)moveTime * 1000 / REFRESH_INTERVAL;
+  int travel = to > from ? to - from : from - to;
+  int maxStep = (int)(SLOPES[profile] * travel / frames) + 1;
+  int last = from, largest = 0;
+  unsigned long arrival = 0, backwards = 0;
+  for( unsigned long frame = 1; frame <= frames + 2; frame++ ) {
+    servoHostRun(REFRESH_INTERVAL);
+    int us = servo.readMicroseconds();
+    int step = to > from ? us - last : last - us;
+    if( step < 0 )
+      backwards++;
+    if( step > largest )
+      largest = step;
+    if( us == to && !arrival )
+      arrival = frame;
+    last = us;
+  }
+  if( backwards || largest > maxStep || !arrival || arrival > frames )
+    fprintf(stderr, "move %d -> %d uS in %u ms, profile %d: %lu steps back, largest step %d uS (%d allowed), "
+            "arrived on frame %lu of %lu\n", from, to, moveTime, PROFILES[profile], backwards, largest, maxStep, arrival, frames);
+  HOST_CHECK( backwards == 0 );
+  HOST_CHECK( largest <= maxStep );
+  HOST_CHECK( arrival && arrival <= frames );
+  HOST_CHECK( !servo.moving() );
+}
+
+static void checkCarriedFrame(ServoEx &servo, ServoEx &other)
+{
+  servo.writeMicroseconds(1000);
+  other.writeMicroseconds(1000);
+  servoHostRun(2 * REFRESH_INTERVAL);
+
+  ServoFrame.start();
+  servo.writeMicroseconds(1500);
+  other.writeMicroseconds(1500);
+  ServoFrame.publish();
+  // until the timer of servo latched the frame, the other one not yet
+  unsigned long us = 0;
+  while( servo.readMicroseconds() != 1500 && us++ < 2UL * REFRESH_INTERVAL )
+    servoHostRun(1);
+  HOST_CHECK( servo.readMicroseconds() == 1500 );
+  HOST_CHECK( other.readMicroseconds() == 1000 && ServoFrame.pending() );
+
+  // an empty frame, the other timer still takes the carried write
+  servo.move(2000, 200);
+  ServoFrame.start();
+  ServoFrame.publish();
+
+  servoHostRun(REFRESH_INTERVAL);
+  HOST_CHECK( servo.moving() );
+  HOST_CHECK( other.readMicroseconds() == 1500 );
+  servoHostRun(200000UL + 2 * REFRESH_INTERVAL);
+  if( servo.readMicroseconds() != 2000 )
+    fprintf(stderr, "move over a carried frame ended at %d uS\n", servo.readMicroseconds());
+  HOST_CHECK( servo.readMicroseconds() == 2000 );
+  HOST_CHECK( !servo.moving() );
+}
+
+int main()
+{
+  // one servo on each timer
+  ServoEx::allocate(2, 1);
+  ServoEx servo, other;
+  servo.attach(PIN);
+  other.attach(OTHER_PIN);
+  HOST_CHECK( servo.timer() != other.timer() );
+#if SERVO_SLEW
+  servo.setSlewLimits(0, 0);
+  other.setSlewLimits(0, 0);
+#endif
+  for( unsigned int t = 0; t < sizeof(MOVE_TIMES) / sizeof(MOVE_TIMES[0]); t++ ) {
+    for( int p = 0; p < (int)sizeof(PROFILES); p++ ) {
+      checkMove(servo, 1000, 2000, MOVE_TIMES[t], p);
+      checkMove(servo, 2000, 1000, MOVE_TIMES[t], p);
+    }
+  }
+  checkCarriedFrame(servo, other);
+  return hostTestResult("ServoMoveTest");
+}
@@ -0,0 +1,161 @@
+/*
+  ServoQueueTest.cpp - Keyframe queue of ServoEx between the main loop and the ISR
+
+  The main loop is the producer, a second thread stands in for the interrupts and runs the virtual timers
+  while keyframes are queued, so producer and consumers touch the ring at the same time like on the board.
+  - wrap-around: the queue takes SERVO_QUEUE_LENGTH - 1 keyframes, refuses the next one, and a frame
+    pulses only the latest due keyframe; repeated until the indices wrapped several times
+  - streaming: 2000 keyframes, each pin pulses every keyframe in order, all servos of a timer pulse the same
+    keyframe in a frame (no keyframe is torn), no underruns
+  - underrun: frames without a keyframe are counted once streaming stopped, clear() resets the count
+*/
+
+#include <ServoHost.h>
+#include <ServoEx.h>
+
+#include "HostTest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const int SERVOS = SERVO_QUEUE_CHANNELS;
+static const int FIRST_PIN = 22;              // pins 22..39 are no output compare pins
+static const int FRAME_MS = REFRESH_INTERVAL / 1000;
+static const int KEYFRAMES = 2000;
+static const int CYCLE = 50;                  // keyframe numbers are encoded modulo CYCLE in the widths
+
+static ServoEx servos[SERVOS];
+
+// pulse width of servo i in keyframe k, decodable from the pulse alone
+static int width(int k, int i)
+{
+  return 1000 + (k % CYCLE) * 20 + i;
+}
+
+static bool queueKeyframe(unsigned long due, int k)
+{
+  if( !ServoQueue.start(due) )
+    return false;
+  for( int i = 0; i < SERVOS; i++ )
+    servos[i].writeMicroseconds(width(k, i));
+  ServoQueue.commit();
+  return true;
+}
+
+static void checkWrapAround()
+{
+  for( int round = 0; round < 3; round++ ) {
+    int queued = 0;
+    while( queued < SERVO_QUEUE_LENGTH && queueKeyframe(millis(), round * SERVO_QUEUE_LENGTH + queued) )
+      queued++;
+    HOST_CHECK( queued == SERVO_QUEUE_LENGTH - 1 );
+    HOST_CHECK( ServoQueue.depth() == SERVO_QUEUE_LENGTH - 1 );
+    servoHostRun(2 * REFRESH_INTERVAL);
+    HOST_CHECK( ServoQueue.depth() == 0 );
+    for( int i = 0; i < SERVOS; i++ )
+      HOST_CHECK( servos[i].readMicroseconds() == width(round * SERVO_QUEUE_LENGTH + queued - 1, i) );
+  }
+}
+
+static void checkStreaming()
+{
+  // all pins at keyframe 0 before tracing, so every traced pulse decodes
+  queueKeyframe(millis(), 0);
+  servoHostRun(2 * REFRESH_INTERVAL);
+  servoHostClearTrace();
+  servoHostTrace(true);
+  unsigned int underruns = ServoQueue.underruns();
+
+  // the interrupts only advance while the queue is well filled, virtual time would run away from the
+  // producer otherwise.  A full queue makes the producer wait
+  std::atomic<bool> done(false);
+  std::thread isr([&done]() {
+    while( !done || ServoQueue.depth() ) {
+      if( done || ServoQueue.depth() >= SERVO_QUEUE_LENGTH / 2 )
+        servoHostRun(REFRESH_INTERVAL / 10);
+      else
+        std::this_thread::yield();
+    }
+  });
+  unsigned long due = millis() + FRAME_MS;
+  for( int k = 1; k < KEYFRAMES; k++, due += FRAME_MS ) {
+    while( !queueKeyframe(due, k) )
+      std::this_thread::yield();
+  }
+  done = true;
+  isr.join();
+  servoHostRun(2 * REFRESH_INTERVAL);
+  servoHostTrace(false);
+  HOST_CHECK( ServoQueue.underruns() - underruns <= 2 * _Nbr_16timers );   // the last frames after draining
+
+  size_t count;
+  const servoHostEdge_t *edges = servoHostEdges(&count);
+  std::vector<int> sequences[SERVOS];
+  for( int i = 0; i < SERVOS; i++ ) {
+    uint64_t rise = 0;
+    int undecodable = 0, skipped = 0, backwards = 0;
+    for( size_t e = 0; e < count; e++ ) {
+      if( edges[e].pin != FIRST_PIN + i )
+        continue;
+      if( edges[e].level ) {
+        rise = edges[e].ticks;
+        continue;
+      }
+      if( !rise )
+        continue;
+      int us = (int)(edges[e].ticks - rise) / 2 + 2;            // TRIM_DURATION of ServoEx.cpp
+      if( (us - 1000 - i) % 20 != 0 || us < 1000 ) {
+        undecodable++;
+        continue;
+      }
+      int k = (us - 1000 - i) / 20;
+      if( !sequences[i].empty() ) {
+        int step = (k - sequences[i].back() + CYCLE) % CYCLE;
+        if( step > 1 )
+          step > CYCLE / 2 ? backwards++ : skipped++;
+      }
+      sequences[i].push_back(k);
+    }
+    HOST_CHECK( undecodable == 0 );
+    HOST_CHECK( skipped == 0 );
+    HOST_CHECK( backwards == 0 );
+    HOST_CHECK( !sequences[i].empty() && sequences[i].back() == (KEYFRAMES - 1) % CYCLE );
+    HOST_CHECK( (int)sequences[i].size() >= KEYFRAMES );
+  }
+  for( int i = 1; i < SERVOS; i++ ) {
+    for( int j = 0; j < i; j++ ) {
+      if( servos[i].timer() == servos[j].timer() )
+        HOST_CHECK( sequences[i] == sequences[j] );
+    }
+  }
+  servoHostClearTrace();
+}
+
+static void checkUnderruns()
+{
+  unsigned int underruns = ServoQueue.underruns();
+  servoHostRun(10 * REFRESH_INTERVAL);
+  HOST_CHECK( ServoQueue.underruns() - underruns >= 9 );
+  ServoQueue.clear();
+  HOST_CHECK( ServoQueue.underruns() == 0 );
+  servoHostRun(10 * REFRESH_INTERVAL);
+  HOST_CHECK( ServoQueue.underruns() == 0 );               // not streaming since clear
+}
+
+int main()
+{
+  for( int i = 0; i < SERVOS; i++ ) {
+    servos[i].attach(FIRST_PIN + i);
+#if SERVO_SLEW
+    servos[i].setSlewLimits(0, 0);
+#endif
+  }
+  servoHostRun(2 * REFRESH_INTERVAL);
+
+  checkWrapAround();
+  if( !hostTestFailures )         // the producer would wait forever on a broken ring
+    checkStreaming();
+  checkUnderruns();
+  return hostTestResult("ServoQueueTest");
+}
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Runs a host program built from a git revision and from the working tree and compares the output
+#
+#   ./compare.sh <ref> <program> [arguments]     e.g. ./compare.sh HEAD~1 DinogSim
+#
+# Identical outputs are reported as such.  Otherwise both are printed side by side, and for outputs of the
+# same shape the number of differing values and the largest difference.  The ref is built with the Host
+# directory of the working tree, revisions without the ServoEx host backend borrow ServoEx from the working tree
+
+set -e
+cd "$(dirname "$0")"
+[ $# -ge 2 ] || { echo "usage: $0 <ref> <program> [arguments]"; exit 2; }
+ref=$1
+program=$2
+shift 2
+
+old=build/ref
+rm -rf $old
+mkdir -p $old
+( cd .. && git archive "$ref" ServoEx Math Dinog ) | tar -x -C $old
+# revisions before the host backend run on the ServoEx of the working tree
+if [ ! -f $old/ServoEx/ServoHost.cpp ]; then
+  rm -rf $old/ServoEx
+  cp -r ../ServoEx $old/ServoEx
+fi
+[ -f $old/Math/Pgmspace.h ] || cp ../Math/Pgmspace.h $old/Math/
+# LineSegment::operator= had no return before the compact segments, undefined behaviour that hangs -O1 and up
+sed -i 's/^\( *\)m_mode = other.m_mode;$/&\n\1return *this;/' $old/Math/LineSegment.h
+make -s ROOT=$old BUILD=$old/build $old/build/$program
+make -s build/$program
+
+$old/build/$program "$@" > build/$program.ref.txt
+build/$program "$@" > build/$program.txt
+
+if cmp -s build/$program.ref.txt build/$program.txt; then
+  echo "$program $*: same output as $ref"
+  exit 0
+fi
+if [ $(wc -l < build/$program.ref.txt) -gt 40 ]; then
+  echo "$program $*: output differs from $ref"
+else
+  paste -d '|' build/$program.ref.txt build/$program.txt
+fi
+paste -d ' ' build/$program.ref.txt build/$program.txt | awk '
+  NF % 2 { shape = 1; exit }
+  {
+    n = NF / 2
+    for( i = 1; i <= n; i++ ) {
+      values++
+      d = $i - $(i + n)
+      if( d < 0 ) d = -d
+      if( d > 0 ) changed++
+      if( d > largest ) largest = d
+    }
+  }
+  END { if( !shape ) printf "%d of %d values differ, largest difference %g\n", changed, values, largest }'
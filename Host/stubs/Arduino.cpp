@@ -0,0 +1,154 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+HardwareSerial Serial( STDERR_FILENO );
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+HardwareSerial Serial3;
+
+EEPROMClass EEPROM;
+
+void delayMicroseconds( unsigned int us )
+{
+    servoHostRun( us );
+}
+
+HardwareSerial::HardwareSerial( int fd )
+    : m_fd( fd )
+{
+}
+
+void HardwareSerial::setOutput( int fd )
+{
+    m_fd = fd;
+}
+
+void HardwareSerial::begin( unsigned long baud )
+{
+    m_baud = baud;
+    m_sentTicks = servoHostTicks();
+}
+
+void HardwareSerial::end()
+{
+    flush();
+    m_baud = 0;
+}
+
+void HardwareSerial::flush()
+{
+    while( pending() )
+    {
+        servoHostTick();
+    }
+}
+
+int HardwareSerial::available()
+{
+    return 0;
+}
+
+int HardwareSerial::read()
+{
+    return -1;
+}
+
+size_t HardwareSerial::pending()
+{
+    uint64_t now = servoHostTicks();
+    if( !m_baud || m_sentTicks <= now )
+        return 0;
+
+    // 10 bits per byte, 2 timer ticks per microsecond
+    uint64_t byteTicks = 20000000ULL / m_baud;
+    return ( size_t ) ( ( m_sentTicks - now + byteTicks - 1 ) / byteTicks );
+}
+
+int HardwareSerial::availableForWrite()
+{
+    // one byte is in the shift register, the ring buffer keeps one slot free
+    size_t queued = pending();
+    queued = queued ? queued - 1 : 0;
+    return queued < TX_BUFFER_SIZE - 1 ? ( int ) ( TX_BUFFER_SIZE - 1 - queued ) : 0;
+}
+
+size_t HardwareSerial::write( uint8_t value )
+{
+    return write( &value, 1 );
+}
+
+size_t HardwareSerial::write( const uint8_t* buffer, size_t size )
+{
+    for( size_t i = 0; i < size; ++i )
+    {
+        if( m_baud )
+        {
+            // blocks until the buffer has room, like the Arduino core
+            while( availableForWrite() == 0 )
+            {
+                servoHostTick();
+            }
+            uint64_t now = servoHostTicks();
+            m_sentTicks = ( m_sentTicks > now ? m_sentTicks : now ) + 20000000ULL / m_baud;
+        }
+        if( m_fd >= 0 && ::write( m_fd, buffer + i, 1 ) != 1 )
+            return i;
+    }
+    return size;
+}
+
+size_t HardwareSerial::printf( const char* format, ... )
+{
+    char text[64];
+    va_list args;
+    va_start( args, format );
+    int n = vsnprintf( text, sizeof( text ), format, args );
+    va_end( args );
+    if( n < 0 )
+        return 0;
+    return write( ( const uint8_t* ) text, n < ( int ) sizeof( text ) ? n : sizeof( text ) - 1 );
+}
+
+size_t HardwareSerial::print( const char* value )
+{
+    return write( ( const uint8_t* ) value, strlen( value ) );
+}
+
+size_t HardwareSerial::print( char value )
+{
+    return write( ( uint8_t ) value );
+}
+
+size_t HardwareSerial::print( int value )
+{
+    return printf( "%d", value );
+}
+
+size_t HardwareSerial::print( unsigned int value )
+{
+    return printf( "%u", value );
+}
+
+size_t HardwareSerial::print( long value )
+{
+    return printf( "%ld", value );
+}
+
+size_t HardwareSerial::print( unsigned long value )
+{
+    return printf( "%lu", value );
+}
+
+size_t HardwareSerial::print( double value, int digits )
+{
+    return printf( "%.*f", digits, value );
+}
+
+size_t HardwareSerial::println()
+{
+    return print( "\r\n" );
+}
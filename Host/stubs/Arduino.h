@@ -0,0 +1,28 @@
+#pragma once
+
+// Arduino core stand-in for the host builds ( see Host/Makefile ).
+// ServoHost provides the virtual clock, the timers and the ports, the rest of the core
+// the libraries and Dinog use is declared here
+#include <ServoHost.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+
+#include "HardwareSerial.h"
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define min( a, b ) ( ( a ) < ( b ) ? ( a ) : ( b ) )
+#define max( a, b ) ( ( a ) > ( b ) ? ( a ) : ( b ) )
+#define constrain( amt, low, high ) ( ( amt ) < ( low ) ? ( low ) : ( ( amt ) > ( high ) ? ( high ) : ( amt ) ) )
+#define radians( deg ) ( ( deg ) * DEG_TO_RAD )
+#define degrees( rad ) ( ( rad ) * RAD_TO_DEG )
+
+#define F( string ) ( string )
+
+void delayMicroseconds( unsigned int us );
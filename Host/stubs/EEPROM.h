@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// 4 KB of EEPROM in memory, erased ( 0xFF ) at start like a new board
+class EEPROMClass
+{
+public:
+    static const int SIZE = 4096;
+
+    EEPROMClass()
+    {
+        memset( m_data, 0xFF, SIZE );
+    }
+
+    uint8_t read( int address )
+    {
+        return m_data[address];
+    }
+
+    void write( int address, uint8_t value )
+    {
+        m_data[address] = value;
+    }
+
+    void update( int address, uint8_t value )
+    {
+        m_data[address] = value;
+    }
+
+    template< class T >
+    T& get( int address, T& value )
+    {
+        memcpy( &value, m_data + address, sizeof( T ) );
+        return value;
+    }
+
+    template< class T >
+    const T& put( int address, const T& value )
+    {
+        memcpy( m_data + address, &value, sizeof( T ) );
+        return value;
+    }
+
+private:
+    uint8_t m_data[SIZE];
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// UART stand-in: bytes go to a file descriptor ( none by default, Serial writes to stderr ).
+// The transmit buffer drains at the baud rate on the virtual clock of ServoHost, so availableForWrite
+// and a full buffer behave like on the board, write blocks by advancing virtual time
+class HardwareSerial
+{
+public:
+    static const int TX_BUFFER_SIZE = 64;
+
+    explicit HardwareSerial( int fd = -1 );
+
+    // output file descriptor, -1 drops the bytes
+    void setOutput( int fd );
+
+    void begin( unsigned long baud );
+    void end();
+    void flush();
+
+    int available();
+    int read();
+    int availableForWrite();
+
+    size_t write( uint8_t value );
+    size_t write( const uint8_t* buffer, size_t size );
+
+    size_t print( const char* value );
+    size_t print( char value );
+    size_t print( int value );
+    size_t print( unsigned int value );
+    size_t print( long value );
+    size_t print( unsigned long value );
+    size_t print( double value, int digits = 2 );
+
+    size_t println();
+    template< class T >
+    size_t println( T value )
+    {
+        size_t n = print( value );
+        return n + println();
+    }
+
+private:
+    // bytes not sent yet at the current virtual time
+    size_t pending();
+    size_t printf( const char* format, ... );
+
+    int m_fd;
+    unsigned long m_baud {};
+    // virtual time in timer ticks when the last queued byte has left the shift register
+    uint64_t m_sentTicks {};
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
@@ -0,0 +1,4 @@
+#pragma once
+
+// Flash is ordinary memory on the host, Math/Pgmspace.h has the definitions
+#include <Pgmspace.h>
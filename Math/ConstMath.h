@@ -0,0 +1,113 @@
+#pragma once
+
+// constexpr versions of math functions used to build tables at compile time
+// They are written for C++11 constexpr rules (single return statement)
+// and are not intended to be called at runtime
+
+static constexpr double CONST_PI = 3.14159265358979323846;
+static constexpr double CONST_SQRT3 = 1.73205080756887729353;
+
+constexpr double const_abs( double x )
+{
+    return x < 0 ? -x : x;
+}
+
+constexpr double const_min( double a, double b )
+{
+    return a < b ? a : b;
+}
+
+constexpr double const_max( double a, double b )
+{
+    return a > b ? a : b;
+}
+
+constexpr double const_clamp( double x, double lo, double hi )
+{
+    return x < lo ? lo : ( x > hi ? hi : x );
+}
+
+constexpr double const_degrees( double rad )
+{
+    return rad * 180.0 / CONST_PI;
+}
+
+constexpr double const_radians( double deg )
+{
+    return deg * CONST_PI / 180.0;
+}
+
+constexpr long const_round( double x )
+{
+    return x >= 0 ? long( x + 0.5 ) : -long( -x + 0.5 );
+}
+
+// Newton iterations
+constexpr double const_sqrtIter( double x, double guess, int n )
+{
+    return n == 0 ? guess : const_sqrtIter( x, 0.5 * ( guess + x / guess ), n - 1 );
+}
+
+constexpr double const_sqrt( double x )
+{
+    return x <= 0 ? 0 : const_sqrtIter( x, x > 1 ? x : 1, 40 );
+}
+
+// x - x^3/3! + x^5/5! - ... , |x| <= pi
+constexpr double const_sinSeries( double x2, double term, int k, int n )
+{
+    return n == 0 ? 0 : term + const_sinSeries( x2, -term * x2 / ( ( 2 * k + 2 ) * ( 2 * k + 3 ) ), k + 1, n - 1 );
+}
+
+// x reduced to [-pi; pi]
+constexpr double const_sinReduced( double x )
+{
+    return const_sinSeries( x * x, x, 0, 20 );
+}
+
+constexpr double const_sin( double x )
+{
+    return const_sinReduced( x - 2 * CONST_PI * const_round( x / ( 2 * CONST_PI ) ) );
+}
+
+constexpr double const_cos( double x )
+{
+    return const_sin( x + CONST_PI / 2 );
+}
+
+// x - x^3/3 + x^5/5 - ... , |x| <= 2 - sqrt(3)
+constexpr double const_atanSeries( double x2, double p, int k, int n )
+{
+    return n == 0 ? 0 : p / ( 2 * k + 1 ) - const_atanSeries( x2, p * x2, k + 1, n - 1 );
+}
+
+// 0 <= x <= 1
+constexpr double const_atanReduced( double x )
+{
+    return x <= 2 - CONST_SQRT3 ?
+        const_atanSeries( x * x, x, 0, 10 ) :
+        CONST_PI / 6 + const_atanSeries( ( ( CONST_SQRT3 * x - 1 ) / ( CONST_SQRT3 + x ) ) * ( ( CONST_SQRT3 * x - 1 ) / ( CONST_SQRT3 + x ) ),
+                                         ( CONST_SQRT3 * x - 1 ) / ( CONST_SQRT3 + x ), 0, 10 );
+}
+
+constexpr double const_atan( double x )
+{
+    return x < 0 ? -const_atan( -x ) :
+        ( x > 1 ? CONST_PI / 2 - const_atanReduced( 1 / x ) : const_atanReduced( x ) );
+}
+
+constexpr double const_atan2( double y, double x )
+{
+    return x > 0 ? const_atan( y / x ) :
+        x < 0 ? ( y >= 0 ? const_atan( y / x ) + CONST_PI : const_atan( y / x ) - CONST_PI ) :
+        y > 0 ? CONST_PI / 2 :
+        y < 0 ? -CONST_PI / 2 : 0;
+}
+
+// argument is clamped to [-1; 1]
+constexpr double const_acos( double x )
+{
+    return x >= 1 ? 0 :
+        x <= -1 ? CONST_PI :
+        const_atan2( const_sqrt( 1 - x * x ), x );
+}
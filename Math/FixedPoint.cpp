@@ -0,0 +1,136 @@
+#include "FixedPoint.h"
+#include "Pgmspace.h"
+
+namespace
+{
+    static const int CORDIC_ITERATIONS = 18;
+
+    // atan( 2^-i ) in degrees, Q16.16
+    const int32_t CORDIC_ATAN[CORDIC_ITERATIONS] PROGMEM = {
+        2949120, 1740967, 919879, 466945, 234379, 117304,
+        58666, 29335, 14668, 7334, 3667, 1833,
+        917, 458, 229, 115, 57, 29
+    };
+
+    // keep vector magnitude in [2^28; 2^29) so CORDIC gain (~1.65)
+    // does not overflow and small vectors do not lose precision
+    static const uint32_t CORDIC_NORM_MIN = 1UL << 28;
+    static const uint32_t CORDIC_NORM_MAX = 1UL << 29;
+
+    // isqrt_mul32 operands are normalized to [2^28; 2^30)
+    static const uint32_t SQRT_NORM_MIN = 1UL << 28;
+    static const uint32_t SQRT_NORM_MAX = 1UL << 30;
+
+    // shifts v by even number of bits into [SQRT_NORM_MIN; SQRT_NORM_MAX)
+    // returns the half of the applied right shift
+    int normalizeSqrt( uint32_t& v )
+    {
+        int shift = 0;
+        while( v >= SQRT_NORM_MAX )
+        {
+            v >>= 2;
+            ++shift;
+        }
+        while( v < SQRT_NORM_MIN )
+        {
+            v <<= 2;
+            --shift;
+        }
+        return shift;
+    }
+}
+
+uint32_t isqrt32( uint32_t v )
+{
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    while( bit > v )
+        bit >>= 2;
+
+    while( bit )
+    {
+        if( v >= res + bit )
+        {
+            v -= res + bit;
+            res = ( res >> 1 ) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // v holds the remainder now, round to nearest
+    if( v > res )
+        ++res;
+
+    return res;
+}
+
+uint32_t isqrt_mul32( uint32_t a, uint32_t b )
+{
+    if( !a || !b )
+        return 0;
+
+    int shift = normalizeSqrt( a ) + normalizeSqrt( b );
+    uint32_t res = isqrt32( a ) * isqrt32( b );
+
+    if( shift >= 0 )
+        return res << shift;
+
+    return ( res + ( 1UL << ( -shift - 1 ) ) ) >> -shift;
+}
+
+int32_t atan2_fx( int32_t y, int32_t x )
+{
+    if( x == 0 && y == 0 )
+        return 0;
+
+    int32_t angle = 0;
+
+    // rotate to the right half plane
+    if( x < 0 )
+    {
+        angle = y >= 0 ? FX_ANGLE_180 : -FX_ANGLE_180;
+        x = -x;
+        y = -y;
+    }
+
+    uint32_t m = ( uint32_t ) x | ( uint32_t ) ( y < 0 ? -y : y );
+    while( m >= CORDIC_NORM_MAX )
+    {
+        x >>= 1;
+        y >>= 1;
+        m >>= 1;
+    }
+    while( m < CORDIC_NORM_MIN )
+    {
+        x <<= 1;
+        y <<= 1;
+        m <<= 1;
+    }
+
+    for( int i = 0; i < CORDIC_ITERATIONS; ++i )
+    {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+        int32_t da = pgm_read_dword( &CORDIC_ATAN[i] );
+
+        if( y > 0 )
+        {
+            x += dx;
+            y -= dy;
+            angle += da;
+        }
+        else
+        {
+            x -= dx;
+            y += dy;
+            angle -= da;
+        }
+    }
+
+    return angle;
+}
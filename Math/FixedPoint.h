@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed point helpers for targets without FPU
+// Angles are represented in degrees as Q16.16 numbers
+
+static const int FX_ANGLE_SHIFT = 16;
+static const int32_t FX_ANGLE_ONE = 1L << FX_ANGLE_SHIFT;
+static const int32_t FX_ANGLE_90 = 90L << FX_ANGLE_SHIFT;
+static const int32_t FX_ANGLE_180 = 180L << FX_ANGLE_SHIFT;
+
+// round( sqrt( v ) )
+uint32_t isqrt32( uint32_t v );
+
+// sqrt( a * b ) without 64 bit intermediate product
+// both square roots are normalized first, so relative error stays below 2^-14
+uint32_t isqrt_mul32( uint32_t a, uint32_t b );
+
+// four quadrant arctangent of y / x (CORDIC, no divisions)
+// result is in range [-180; 180] degrees, Q16.16
+// max error is below 0.001 degree
+int32_t atan2_fx( int32_t y, int32_t x );
+
+// converts Q16.16 angle to integer degrees truncating towards zero,
+// as float -> int conversion does
+inline int fx_toDegrees( int32_t angle )
+{
+    return angle / FX_ANGLE_ONE;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <MathUtils.h>
+#include <stdint.h>
 
+// Line through a reference point, optionally trimmed to a domain where evaluate clamps t.
+// The value is kept at a reference time rather than as an intercept at t = 0, which would lose
+// float precision when t counts seconds since boot
 template< class T >
 class LineSegment
 {
@@ -10,24 +14,6 @@ public:
     {
     }
 
-    LineSegment( const LineSegment& other )
-    {
-        *this = other;
-    }
-
-    LineSegment& operator=( const LineSegment& other )
-    {
-        m_v[0] = other.m_v[0];
-        m_v[1] = other.m_v[1];
-        m_t[0] = other.m_t[0];
-        m_t[1] = other.m_t[1];
-        m_slope = other.m_slope;
-        m_domain[0] = other.m_domain[0];
-        m_domain[1] = other.m_domain[1];
-        m_trimmed = other.m_trimmed;
-        m_mode = other.m_mode;
-    }
-
     LineSegment( float slope, const T& v0, float t0 )
     {
         set( slope, v0, t0 );
@@ -40,99 +26,73 @@ public:
             setTrim( t0, t1 );
     }
 
+    // segments shorter than F_TOLERANCE evaluate to zero
     void set( const T& v0, const T& v1, float t0, float t1 )
     {
-        m_mode = TwoPoints;
-        m_v[0] = v0;
-        m_v[1] = v1;
-        m_t[0] = t0;
-        m_t[1] = t1;
+        if( fabs( t0 - t1 ) > F_TOLERANCE )
+            set( ( v1 - v0 ) / ( t1 - t0 ), v0, t0 );
+        else
+            set( 0.0f, T {}, t0 );
     }
 
     void set( float slope, const T& v0, float t0 )
     {
-        m_mode = Slope;
         m_slope = slope;
-        m_v[0] = v0;        
-        m_t[0] = t0;
+        m_v = v0;        
+        m_t = t0;
     }
 
     T evaluate( float t ) const
     {
-        if( m_trimmed )
-        {
-            t = max( t, m_domain[0] );
-            t = min( t, m_domain[1] );
-        }   
-
-        T res {};
+        // an untrimmed domain is infinite
+        t = max( t, m_domain[0] );
+        t = min( t, m_domain[1] );
 
-        if( m_mode == TwoPoints )
-        {
-            if( fabs( m_t[0] - m_t[1] ) > F_TOLERANCE )
-                res = lerp( m_v[0], m_v[1], m_t[0], m_t[1], t );
-
-        }            
-        else
-        {
-            res = m_slope * ( t - m_t[0] ) + m_v[0];
-        }   
-        return res;
+        return m_slope * ( t - m_t ) + m_v;
     }
 
     bool findT( const T& value, float& t )
     {
-        if( m_mode == TwoPoints )
+        if( fabs(m_slope) > F_TOLERANCE )
         {
-            if( fabs(m_v[0] - m_v[1]) > F_TOLERANCE )
-            {
-                t = lerp( m_t[0], m_t[1], m_v[0], m_v[1], value );
-                return true;
-            }
-        }            
-        else
-        {
-            if( fabs(m_slope) > F_TOLERANCE )
-            {
-                t = ( value - m_v[0] ) / m_slope + m_t[0];
-                return true;
-            }
+            t = ( value - m_v ) / m_slope + m_t;
+            return true;
         }
         return false;
     }
 
     void setTrim( float t0, float t1 )
     {
-        m_trimmed = true;
         m_domain[0] = min( t0, t1 );
         m_domain[1] = max( t0, t1 );
     }
 
     void removeTrim()
     {
-        m_trimmed = false;
+        m_domain[0] = -INFINITY;
+        m_domain[1] = INFINITY;
     }
 
     float domainMin() const
     {
-        return m_trimmed ? m_domain[0] : -INFINITY;
+        return m_domain[0];
     }
 
     float domainMax() const
     {
-        return m_trimmed ? m_domain[1] : INFINITY;
+        return m_domain[1];
     }
 
 private:
-    T m_v[2] {};
-    float m_t[2]{};    
+    T m_v {};
+    float m_t {};    
     float m_slope {};
 
-    float m_domain[2] {};
-    bool m_trimmed {};
-    enum { TwoPoints, Slope } m_mode;
+    float m_domain[2] { -INFINITY, INFINITY };
 };
 
+// Segments must be pushed in time order and must not overlap.
+// evaluate starts at the segment of the previous query, so monotonic queries take constant time
 template< class T, int MAX_SIZE >
 class Polyline
 {
@@ -149,11 +109,12 @@ public:
     void clear()
     {
         m_size = 0;
+        m_cursor = 0;
     }
 
     void pushSegment( const LineSegment<T>& seg )
     {
-        if( m_size + 1 < MAX_SIZE )
+        if( m_size < MAX_SIZE )
         {
             m_segments[m_size++] = seg;
         }
@@ -161,14 +122,21 @@ public:
 
     bool evaluate( float t, T& val ) const
     {
-        for( int i = 0; i < m_size; ++i )
+        if( !m_size )
+            return false;
+
+        int i = m_cursor;
+        while( i > 0 && t < m_segments[i].domainMin() )
+            --i;
+        while( i < m_size - 1 && t >= m_segments[i].domainMax() )
+            ++i;
+        m_cursor = i;
+
+        auto& seg = m_segments[i];
+        if( t >= seg.domainMin() && t < seg.domainMax() )
         {
-            auto& seg = m_segments[i];
-            if( t >= seg.domainMin() && t < seg.domainMax() )
-            {
-                val = seg.evaluate( t );
-                return true;
-            }
+            val = seg.evaluate( t );
+            return true;
         }
         return false;
     }
@@ -185,11 +153,11 @@ public:
 
     float domainMax() const
     {
-        return m_size ? m_segments[m_size - 1].domainMin() : 0.0f;
+        return m_size ? m_segments[m_size - 1].domainMax() : 0.0f;
     }
 
 private:
     LineSegment<T> m_segments[MAX_SIZE];
-    int m_size {};
+    uint8_t m_size {};
+    mutable uint8_t m_cursor {};
 };
-
@@ -25,4 +25,131 @@ float map_f( long x, long in_min, long in_max, float out_min, float out_max, int
         return out_max;
     }    
     return float( x - in_min ) * ( out_max - out_min ) / float( in_max - in_min ) + out_min;
-}
\ No newline at end of file
+}
+
+namespace
+{
+    // arctangent on [0; 1]
+    float atanReduced( float x )
+    {
+#if FAST_MATH_PRECISION == FAST_MATH_LOW
+        return x * ( float( M_PI_4 ) + 0.273f * ( 1 - x ) );
+#elif FAST_MATH_PRECISION == FAST_MATH_MEDIUM
+        auto x2 = x * x;
+        return x * ( 0.9998660f + x2 * ( -0.3302995f + x2 * ( 0.1801410f + x2 * ( -0.0851330f + x2 * 0.0208351f ) ) ) );
+#else
+        auto x2 = x * x;
+        return x * ( 0.99999934f + x2 * ( -0.33329856f + x2 * ( 0.19946536f + x2 * ( -0.13908534f + x2 * ( 0.09642004f + x2 * ( -0.05590988f + x2 * ( 0.02186123f + x2 * -0.00405404f ) ) ) ) ) ) );
+#endif
+    }
+
+    // arccosine on [0; 1] as sqrt( 1 - x ) * P( x )
+    float acosReduced( float x )
+    {
+#if FAST_MATH_PRECISION == FAST_MATH_LOW
+        auto p = 1.56758f - 0.16820f * x;
+#elif FAST_MATH_PRECISION == FAST_MATH_MEDIUM
+        auto p = 1.5707288f + x * ( -0.2121144f + x * ( 0.0742610f + x * -0.0187293f ) );
+#else
+        auto p = 1.5707963050f + x * ( -0.2145988016f + x * ( 0.0889789874f + x * ( -0.0501743046f +
+                 x * ( 0.0308918810f + x * ( -0.0170881256f + x * ( 0.0066700901f + x * -0.0012624911f ) ) ) ) ) );
+#endif
+        return fast_sqrt( 1 - x ) * p;
+    }
+
+    // Taylor series, |x| <= pi / 4
+    float sinReduced( float x )
+    {
+        auto x2 = x * x;
+#if FAST_MATH_PRECISION == FAST_MATH_LOW
+        return x * ( 1 + x2 * ( -1.0f / 6 ) );
+#elif FAST_MATH_PRECISION == FAST_MATH_MEDIUM
+        return x * ( 1 + x2 * ( -1.0f / 6 + x2 * ( 1.0f / 120 ) ) );
+#else
+        return x * ( 1 + x2 * ( -1.0f / 6 + x2 * ( 1.0f / 120 + x2 * ( -1.0f / 5040 ) ) ) );
+#endif
+    }
+
+    float cosReduced( float x )
+    {
+        auto x2 = x * x;
+#if FAST_MATH_PRECISION == FAST_MATH_LOW
+        return 1 + x2 * ( -0.5f + x2 * ( 1.0f / 24 ) );
+#elif FAST_MATH_PRECISION == FAST_MATH_MEDIUM
+        return 1 + x2 * ( -0.5f + x2 * ( 1.0f / 24 + x2 * ( -1.0f / 720 ) ) );
+#else
+        return 1 + x2 * ( -0.5f + x2 * ( 1.0f / 24 + x2 * ( -1.0f / 720 + x2 * ( 1.0f / 40320 ) ) ) );
+#endif
+    }
+}
+
+float fast_sqrt( float x )
+{
+    if( x <= 0 )
+        return 0;
+
+    // initial guess of 1 / sqrt( x ) from the float exponent
+    union
+    {
+        float f;
+        uint32_t i;
+    } u { x };
+    u.i = 0x5f3759df - ( u.i >> 1 );
+    auto y = u.f;
+
+    // Newton iterations for 1 / sqrt( x ), no divisions
+    auto hx = 0.5f * x;
+    y *= 1.5f - hx * y * y;
+#if FAST_MATH_PRECISION >= FAST_MATH_MEDIUM
+    y *= 1.5f - hx * y * y;
+#endif
+#if FAST_MATH_PRECISION >= FAST_MATH_HIGH
+    y *= 1.5f - hx * y * y;
+#endif
+    return x * y;
+}
+
+float fast_atan2( float y, float x )
+{
+    auto ax = fabs( x );
+    auto ay = fabs( y );
+    if( ax == 0 && ay == 0 )
+        return 0;
+
+    // reduce to the first octant with one division
+    float res;
+    if( ay > ax )
+        res = float( M_PI_2 ) - atanReduced( ax / ay );
+    else
+        res = atanReduced( ay / ax );
+
+    if( x < 0 )
+        res = float( M_PI ) - res;
+    return y < 0 ? -res : res;
+}
+
+float fast_acos( float x )
+{
+    if( x >= 1 )
+        return 0;
+    if( x <= -1 )
+        return M_PI;
+    return x >= 0 ? acosReduced( x ) : float( M_PI ) - acosReduced( -x );
+}
+
+void fast_sincos( float x, float& s, float& c )
+{
+    // x = q * pi / 2 + r, |r| <= pi / 4
+    auto q = lround( x * float( M_2_PI ) );
+    auto r = ( x - q * float( M_PI_2 ) );
+    auto sr = sinReduced( r );
+    auto cr = cosReduced( r );
+
+    switch( q & 3 )
+    {
+    case 0: s = sr; c = cr; break;
+    case 1: s = cr; c = -sr; break;
+    case 2: s = -sr; c = -cr; break;
+    default: s = -cr; c = sr; break;
+    }
+}
@@ -2,10 +2,41 @@
 
 #include <math.h>
 
-static const float F_TOLERANCE = 1e-03;
+static constexpr float F_TOLERANCE = 1e-03;
 
 float lerp( float v0, float v1, float t );
 
 float lerp( float v0, float v1, float t0, float t1, float t );
 
-float map_f( long x, long in_min, long in_max, float out_min, float out_max, int n_tol );
\ No newline at end of file
+float map_f( long x, long in_min, long in_max, float out_min, float out_max, int n_tol );
+
+// Fast approximations of math functions with bounded error
+// Precision tier is selected at compile time, max absolute errors
+// (host sweep against double precision, angles in radians):
+//
+//                 LOW         MEDIUM      HIGH
+//  fast_sqrt      1.8e-3 rel  4.8e-6 rel  2.1e-7 rel
+//  fast_atan2     3.8e-3      1.2e-5      3.1e-7
+//  fast_acos      5.9e-3      7.5e-5      5.3e-7
+//  fast_sincos    2.5e-3      3.7e-5      4.3e-7
+//
+// Servos resolve about 0.1 deg (1.7e-3 rad), so MEDIUM is enough for IK
+#define FAST_MATH_LOW       0
+#define FAST_MATH_MEDIUM    1
+#define FAST_MATH_HIGH      2
+
+#ifndef FAST_MATH_PRECISION
+#define FAST_MATH_PRECISION FAST_MATH_MEDIUM
+#endif
+
+// returns 0 for x <= 0
+float fast_sqrt( float x );
+
+// four quadrant arctangent of y / x, result is in range [-pi; pi]
+float fast_atan2( float y, float x );
+
+// argument is clamped to [-1; 1]
+float fast_acos( float x );
+
+// sine and cosine of x, best accuracy for |x| <= 2 pi
+void fast_sincos( float x, float& s, float& c );
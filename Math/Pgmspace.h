@@ -0,0 +1,26 @@
+#pragma once
+
+// Flash tables: avr-libc on AVR, ordinary memory everywhere else ( host builds, see Host/Makefile )
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#include <stdint.h>
+#include <string.h>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef PSTR
+#define PSTR( string ) ( string )
+#endif
+// other cores ( ARM, ESP ) declare these in Arduino.h already
+#ifndef pgm_read_byte
+#define pgm_read_byte( address ) ( *( const uint8_t* )( address ) )
+#define pgm_read_word( address ) ( *( const uint16_t* )( address ) )
+#define pgm_read_dword( address ) ( *( const uint32_t* )( address ) )
+#define pgm_read_float( address ) ( *( const float* )( address ) )
+#define pgm_read_ptr( address ) ( *( void* const* )( address ) )
+#define memcpy_P memcpy
+#endif
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Pgmspace.h"
+
+// Compile time generated tables placed in flash
+//
+// Generator is a class with
+//     typedef <type> Type;
+//     static const int SIZE = <number of entries>;
+//     static constexpr Type value( int index );
+//
+// StaticTable< Generator >::data is the PROGMEM array of Generator::value( 0..SIZE-1 )
+
+template< int... I >
+struct IndexList
+{
+};
+
+template< class A, class B >
+struct ConcatIndexList;
+
+template< int... I, int... J >
+struct ConcatIndexList< IndexList< I... >, IndexList< J... > >
+{
+    typedef IndexList< I..., ( sizeof...( I ) + J )... > Type;
+};
+
+// splits range in halves, so template depth is log2( N )
+template< int N >
+struct MakeIndexList
+{
+    typedef typename ConcatIndexList< typename MakeIndexList< N / 2 >::Type,
+                                      typename MakeIndexList< N - N / 2 >::Type >::Type Type;
+};
+
+template<>
+struct MakeIndexList< 0 >
+{
+    typedef IndexList<> Type;
+};
+
+template<>
+struct MakeIndexList< 1 >
+{
+    typedef IndexList< 0 > Type;
+};
+
+template< class Generator, class Indices = typename MakeIndexList< Generator::SIZE >::Type >
+struct StaticTable;
+
+template< class Generator, int... I >
+struct StaticTable< Generator, IndexList< I... > >
+{
+    typedef typename Generator::Type Type;
+    static const int SIZE = sizeof...( I );
+    static constexpr Type data[SIZE] PROGMEM = { Generator::value( I )... };
+};
+
+template< class Generator, int... I >
+constexpr typename Generator::Type StaticTable< Generator, IndexList< I... > >::data[] PROGMEM;
@@ -28,9 +28,19 @@
   The Servos are pulsed in the background using the value most recently written using the write() method
 
   Note that analogWrite of PWM on pins associated with the timer are disabled when the first servo is attached.
-  Timers are seized as needed in groups of 12 servos - 24 servos use two timers, 48 servos will use four.
+  Timers are seized as needed in groups of servos, in the order the servos are created.  By default timers
+  are filled with 12 servos - 24 servos use two timers, 48 servos will use four.  ServoEx::allocate(count, group)
+  spreads count servos evenly over the timers without splitting groups of group servos instead (18 and 3 put
+  the servos of a hexapod on timers 5, 1 and 3 with two legs each).  It is called before the first attach(),
+  SERVO_ALLOCATION_COUNT and SERVO_ALLOCATION_GROUP only set the allocation ServoEx.cpp starts with.
   The sequence used to sieze timers is defined in timers.h
 
+  On the ATmega1280/2560 a servo attached to an output compare pin (OCnA/B/C: pins 11 12 13, 5 2 3, 6 7 8,
+  46 45 44 of timers 1, 3, 4 and 5) whose timer has no servos allocated is pulsed by the timer hardware in
+  fast PWM mode: no edges are written by an ISR and the pulse width has no jitter.  One overflow interrupt per
+  frame updates timed moves and slew limits.  Allocating a servo to such a timer later moves its hardware
+  channels back to the ISR.  Other pins always use the ISR.  SERVO_HARDWARE_PWM 0 turns this off
+
   The methods are:
 
    ServoEx - Class for manipulating servo motors connected to Arduino pins.
@@ -47,8 +57,39 @@
    detach()    - Stops an attached servos from pulsing its i/o pin. 
    
    New methods:
+    allocate(count, group) - Static, spreads count servos over the timers in groups of group servos, 0 fills
+                  every timer.  Returns false once a servo is attached, the allocation is kept then
+    servosPerTimer() - Static, gets the number of servos allocated to each timer
 	moving  	- Returns true if the servo is still moving to it's new location.
-    move	 	- Move the one servo to a new location...
+    move	 	- Move the one servo to a new location, optionally with an ease profile...
+    calibrate(value0, value180) - Sets linear calibration mapping value0..value180 onto the pulse range
+                  the same way write() maps 0..180 degrees (any units, range may be reversed)
+    setCalibration(ticksPerUnit, ticksOffset) - Sets precomputed linear calibration
+    writeCalibrated() - Sets the pulse width in timer ticks as ticksOffset + value * ticksPerUnit,
+                  no map() and no integer degree rounding (0.5 uS resolution)
+    writeTicks()  - Sets the servo pulse width in timer ticks
+    setRefreshInterval(value) - Sets the refresh interval in microseconds of the timer this servo is on,
+                  shared by its group of up to 12 servos.  Returns false if it is longer than
+                  MAX_REFRESH_INTERVAL or the pulses of the attached channels would not fit
+    refreshInterval() - Gets the refresh interval in microseconds of the timer this servo is on
+    refreshRate() - Gets the effective refresh rate in Hz measured from the last completed frame,
+                  lower than 1000000 / refreshInterval() when the frame overran
+    refreshOverruns() - Gets the number of frames whose pulses did not fit into the refresh interval
+    timer()       - Gets the position of the timer this servo is on in the timer sequence, -1 if invalid
+    frameLength() - Gets the worst case frame length in microseconds of the timer this servo is on, the pulses
+                  of all attached channels at their maximum width.  The shortest refresh interval it accepts
+    hardware()    - With SERVO_HARDWARE_PWM 1, returns true if the servo is pulsed by the output compare unit of its
+                  pin instead of the ISR, see below
+    stats(&stats) - With SERVO_STATS 1, copies the ISR duration min/max/mean and the pulse edge error
+                  histogram of the timer this servo is on, all in timer ticks (0.5 uS)
+    resetStats()  - With SERVO_STATS 1, clears the statistics of the timer this servo is on
+    setSlewLimits(maxSpeed, maxAccel) - With SERVO_SLEW 1, limits how fast the pulse width follows writes,
+                  in uS per second and uS per second squared, 0 is no limit.  The ISR steps the pulse
+                  towards the written value once per frame, set the limits after setRefreshInterval
+    slewSaturations() - With SERVO_SLEW 1, gets the number of frames the limits held the pulse back
+    setTravelLimit(value) - Limits the sum of the pulse width changes of the timer this servo is on to value uS
+                  per frame, large steps of many servos are spread over consecutive frames in proportion.
+                  0 is no limit.  Servos pulsed by output compare units are not limited
 	
 	New Class cServoGroupMove - used to start a new group move.  There is one instance of this class
 		defined ServoGroupMove. 
@@ -56,16 +97,50 @@
 	The methods are:	
 
     start 		- Starts a group move.  The servos are not moved until the commit call
-    commit		- Commits the moves(write, writeMicroseconds) that happened since start
+    commit		- Commits the moves(write, writeMicroseconds) that happened since start, optionally with
+				  an ease profile (SERVO_EASE_IN, SERVO_EASE_OUT, SERVO_EASE_IN_OUT), default is linear.
+				  Servos are interpolated from the start to the end point and arrive on the last cycle
+				  of the move time
 
     moving		- Returns a bitmask of the servos that are still moving.  The bits are in the order
 				  the servos were created.
     wait		- Waits for all of the servos defined in the mask are to their end points.
+    saturated	- With SERVO_SLEW 1, returns a bitmask of the servos whose pulse is held back by the slew
+				  limits in the current frame, same bit order as moving
+    hardware	- With SERVO_HARDWARE_PWM 1, returns a bitmask of the servos pulsed by output compare units,
+				  same bit order as moving
+
+	New Class cServoFrame - used to update many servos atomically.  There is one instance of this class
+		defined ServoFrame.
+
+	The methods are:
+
+    start		- Starts a frame.  Writes until publish go to a back buffer, not to the servos (may be nested)
+    publish		- Publishes the back buffer on the outermost call, each timer latches it at the start of its next pulse frame,
+				  so no pulse frame ever mixes old and new values
+    pending		- Returns true while a published frame has not been latched by all timers
+
+	New Class cServoQueue - a ring buffer of timestamped keyframes from the main loop to the ISR, so the
+		main loop can compute several frames ahead.  There is one instance of this class defined ServoQueue.
+		SERVO_QUEUE_LENGTH 0 compiles the class, its storage and the ISR hook out.
+
+	The methods are:
+
+    start		- Starts a keyframe due at the given millis().  Writes until commit go to the keyframe.
+				  Returns false if the queue is full
+    commit		- Queues the keyframe.  Each timer applies the latest due keyframe at the start of a pulse frame
+    depth		- Returns the number of queued keyframes not yet applied by every timer
+    underruns	- Returns the number of frames that started with an empty queue after keyframes were applied
+    clear		- Drops the queued keyframes and resets the underrun count, call it when streaming stops
 
 */
 
+#ifdef SERVOEX_HOST
+#include "ServoHost.h"
+#else
 #include <avr/interrupt.h>
 #include <Arduino.h> 
+#endif
 
 #include "ServoEx.h"
 
@@ -74,12 +149,27 @@
 
 
 cServoGroupMove ServoGroupMove;
+cServoFrame ServoFrame;
+#if SERVO_QUEUE_LENGTH
+cServoQueue ServoQueue;
+#endif
 
 
-#define TRIM_DURATION       2                               // compensation ticks to trim adjust for digitalWrite delays // 12 August 2009
+#define TRIM_DURATION       2                               // compensation ticks to trim adjust for pin write delays // 12 August 2009
 
 //#define NBR_TIMERS        (MAX_SERVOS / SERVOS_PER_TIMER)
 
+// Allocation of servos to timers: servo index / ServosPerTimer is the timer, count servos spread over the timers
+// in whole groups, 0 fills every timer.  Fixed once the first servo is attached
+#define ALLOCATION_GROUPS(_count,_group)  (((_count) + (_group) - 1) / (_group))
+#define ALLOCATION_SPREAD(_count,_group)  (((ALLOCATION_GROUPS(_count,_group) + _Nbr_16timers - 1) / _Nbr_16timers) * (_group))
+#define ALLOCATION(_count,_group)         ((_count) && ALLOCATION_SPREAD(_count,_group) < SERVOS_PER_TIMER_MAX ? \
+                                           ALLOCATION_SPREAD(_count,_group) : SERVOS_PER_TIMER_MAX)
+
+static uint8_t ServosPerTimer = ALLOCATION(SERVO_ALLOCATION_COUNT, SERVO_ALLOCATION_GROUP);
+static uint8_t AllocationGroup = SERVO_ALLOCATION_GROUP;   // servos created one after another that stay on one timer
+static bool AllocationFixed = false;                        // a servo was attached
+
 static servo_t servos[MAX_SERVOS];                          // static array of servo structures
 static volatile int8_t Channel[_Nbr_16timers ];             // counter for the servo being pulsed for each timer (or -1 if refresh interval)
 
@@ -88,62 +178,660 @@ uint8_t ServoCount = 0;                                     // the total number
 // Group move variables
 uint8_t GroupMoveActiveCnt = 0;								// Do we have a group move active at this time?
 
+// Refresh period variables, per timer
+static unsigned int RefreshTicks[_Nbr_16timers];            // refresh period in ticks, set to REFRESH_INTERVAL when the timer starts
+static volatile unsigned int PeriodTicks[_Nbr_16timers];    // length of the last completed frame in ticks
+static volatile unsigned int Overruns[_Nbr_16timers];       // frames whose pulses did not fit into the refresh period
+static unsigned int TravelTicks[_Nbr_16timers];             // pulse width change per frame of all servos on the timer, 0 if not limited
+
+// Frame latch variables
+// The main loop writes FrameTicks[FrameFront ^ 1] and publishes it by flipping FrameFront, a single byte store.
+// The ISR copies the front buffer into the servos at a frame start, it can not be interrupted by the main loop
+// so the copy is atomic and the main loop never writes the buffer the ISR reads.
+#define FRAME_UNCHANGED     ((unsigned int)-1)                // frame entry not written, servo keeps its value
+static unsigned int FrameTicks[2][MAX_SERVOS];
+static volatile uint8_t FrameFront = 0;                     // buffer the ISR latches from
+static volatile uint8_t FramePending = 0;                   // bit per timer that has not latched the front buffer yet
+static uint8_t FrameActive = 0;                             // start count, writes go to the back buffer while not 0
+
+#if SERVO_QUEUE_LENGTH
+// Keyframe queue variables
+// Single producer (main loop), one consumer per timer (its ISR at a frame start). The main loop writes
+// Queue[QueueHead] and publishes it by advancing QueueHead, each timer advances its own QueueTail.
+// A slot is free again once every active timer has consumed it.
+#define QUEUE_MASK          (SERVO_QUEUE_LENGTH - 1)
+#define QUEUE_NEXT(_index)  (((_index) + 1) & QUEUE_MASK)
+#define memory_barrier()    asm volatile("" ::: "memory")       // keeps the compiler from moving slot accesses across index updates
+
+typedef struct {
+  unsigned long due;                                        // millis() at which the keyframe is applied
+  unsigned int ticks[SERVO_QUEUE_CHANNELS];                 // FRAME_UNCHANGED if the servo keeps its value
+} keyframe_t;
+
+static keyframe_t Queue[SERVO_QUEUE_LENGTH];
+static volatile uint8_t QueueHead = 0;                      // slot being written by the main loop
+static volatile uint8_t QueueTail[_Nbr_16timers];           // next slot each timer consumes
+static volatile uint8_t QueueStreaming = 0;                 // bit per timer that consumed a keyframe since the last clear
+static volatile unsigned int QueueUnderruns[_Nbr_16timers]; // frames that started with an empty queue while streaming
+static uint8_t QueueActive = 0;                             // writes go to Queue[QueueHead]
+#endif
+
 // convenience macros
-#define SERVO_INDEX_TO_TIMER(_servo_nbr) ((timer16_Sequence_t)(_servo_nbr / SERVOS_PER_TIMER)) // returns the timer controlling this servo
-#define SERVO_INDEX_TO_CHANNEL(_servo_nbr) (_servo_nbr % SERVOS_PER_TIMER)       // returns the index of the servo on this timer
-#define SERVO_INDEX(_timer,_channel)  ((_timer*SERVOS_PER_TIMER) + _channel)     // macro to access servo index by timer and channel
+#define SERVO_INDEX_TO_TIMER(_servo_nbr) ((timer16_Sequence_t)(_servo_nbr / ServosPerTimer)) // returns the timer controlling this servo
+#define SERVO_INDEX_TO_CHANNEL(_servo_nbr) (_servo_nbr % ServosPerTimer)       // returns the index of the servo on this timer
+#define SERVO_INDEX(_timer,_channel)  ((_timer*ServosPerTimer) + _channel)     // macro to access servo index by timer and channel
+#define SERVO_ALLOCATED(_servo_nbr)   ((_servo_nbr) < _Nbr_16timers * ServosPerTimer)  // true if the servo has a timer
 #define SERVO(_timer,_channel)  (servos[SERVO_INDEX(_timer,_channel)])            // macro to access servo class by timer and channel
 
 #define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)  // minimum value in uS for this servo
 #define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)  // maximum value in uS for this servo 
+#define SERVO_MIN_TICKS() usToTicks((SERVO_MIN() - TRIM_DURATION))  // minimum value in ticks for this servo
+#define SERVO_MAX_TICKS() usToTicks((SERVO_MAX() - TRIM_DURATION))  // maximum value in ticks for this servo
 
 /************ static functions common to all instances ***********************/
 
+// 0.16 fixed point multiply, 65535 stands for 1
+static inline uint16_t mul_fx(uint16_t a, uint16_t b)
+{
+  return ((uint32_t)a * b) >> 16;
+}
+
+// maps linear progress of a move onto the profile, both 0.16 fixed point
+static inline uint16_t ease(uint8_t profile, uint16_t phase)
+{
+  switch (profile) {
+    case SERVO_EASE_IN:
+      return mul_fx(phase, phase);
+    case SERVO_EASE_OUT: {
+      // 2u - u^2
+      uint32_t value = 2 * (uint32_t)phase - mul_fx(phase, phase);
+      return value > 0xFFFF ? 0xFFFF : value;
+    }
+    case SERVO_EASE_IN_OUT: {
+      // smoothstep 3u^2 - 2u^3
+      uint16_t phase2 = mul_fx(phase, phase);
+      uint32_t value = 3 * (uint32_t)phase2 - 2 * (uint32_t)mul_fx(phase2, phase);
+      return value > 0xFFFF ? 0xFFFF : value;
+    }
+    default:
+      return phase;
+  }
+}
+
+// See if we are in a timed move, if so update the move for the next time through...
+// The position is interpolated from the start point by the 0.32 fixed point phase accumulator,
+// no error builds up and the last frame of the move lands exactly on the end point
+static inline void update_move(servo_t *pservo)
+{
+  if (pservo->framesLeft) {
+    if (--pservo->framesLeft == 0) {
+      pservo->ticks = pservo->ticksNew;
+      return;
+    }
+    pservo->phase += pservo->phaseStep;
+    int travel = (int)pservo->ticksNew - (int)pservo->ticksStart;
+    uint16_t progress = ease(pservo->profile, pservo->phase >> 16);
+    pservo->ticks = pservo->ticksStart + (int)(((long)travel * progress + 0x8000) >> 16);
+  }
+}
+
+#if SERVO_SLEW
+#define SLEW_SHIFT          4       // velocity, speed and acceleration limits are in 1/16 ticks
+
+// step the pulse width of this frame towards the written value within the speed and acceleration limits,
+// called once per frame when the pulse width is fixed.  Braking starts when the stopping distance
+// v (v + a) / 2a of the per frame steps reaches the remaining distance, so the pulse arrives without
+// overshooting at a speed of at most a
+static inline void slew(servo_t *pservo)
+{
+  if( !pservo->maxSpeed && !pservo->maxAccel ) {
+    pservo->ticksOut = pservo->ticks;
+    return;
+  }
+  long error = ((long)pservo->ticks << SLEW_SHIFT) - (((long)pservo->ticksOut << SLEW_SHIFT) + pservo->slewFrac);
+  int16_t current = pservo->velocity;
+  if( error == 0 && current == 0 )
+    return;
+
+  long velocity = error;   // reach the written value in this frame if the limits allow
+  if( pservo->maxSpeed ) {
+    if( velocity > pservo->maxSpeed )
+      velocity = pservo->maxSpeed;
+    else if( velocity < -(long)pservo->maxSpeed )
+      velocity = -(long)pservo->maxSpeed;
+  }
+  if( pservo->maxAccel ) {
+    uint16_t accel = pservo->maxAccel;
+    if( current != 0 && (current > 0) == (error > 0) ) {
+      // distance clamped so 2 a d fits 32 bits, brakes early only beyond 4096 ticks
+      uint32_t distance = error > 0 ? error : -error;
+      if( distance > 0xFFFF )
+        distance = 0xFFFF;
+      uint32_t speed = current > 0 ? current : -current;
+      if( speed * (speed + accel) > 2UL * accel * distance ) {
+        long brake = current > 0 ? current - accel : current + accel;
+        if( (brake < 0 ? -brake : brake) < (velocity < 0 ? -velocity : velocity) )
+          velocity = brake;
+      }
+    }
+    if( velocity > (long)current + accel )
+      velocity = (long)current + accel;
+    else if( velocity < (long)current - accel )
+      velocity = (long)current - accel;
+  }
+
+  if( (error > 0 && velocity >= error) || (error < 0 && velocity <= error) ) {
+    // arrived
+    pservo->ticksOut = pservo->ticks;
+    pservo->slewFrac = 0;
+    pservo->velocity = 0;
+    return;
+  }
+  long position = ((long)pservo->ticksOut << SLEW_SHIFT) + pservo->slewFrac + velocity;
+  pservo->ticksOut = position >> SLEW_SHIFT;
+  pservo->slewFrac = position & ((1 << SLEW_SHIFT) - 1);
+  pservo->velocity = velocity;
+  if( pservo->slewLimited != 0xFFFF )
+    pservo->slewLimited++;
+}
+#else
+static inline void slew(servo_t *pservo)
+{
+  pservo->ticksOut = pservo->ticks;
+}
+#endif
+
+// true while the servo is in a timed move or its pulse has not reached the written value,
+// framesLeft and ticksOut are 16 bit and changed by the ISR
+static inline bool is_moving(uint8_t index)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  bool moving = servos[index].framesLeft != 0 ||
+    (servos[index].Pin.isActive && servos[index].ticksOut != servos[index].ticks);
+  SREG = oldSREG;
+  return moving;
+}
+
+// copy the published frame into the servos of this timer, called by latch_frame at the start of a pulse frame,
+// and by cServoFrame::publish with interrupts off for the timers without attached servos
+static inline void copy_frame(timer16_Sequence_t timer)
+{
+  unsigned int *ticks = &FrameTicks[FrameFront][SERVO_INDEX(timer,0)];
+  for( uint8_t channel = 0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++ ) {
+    if( ticks[channel] != FRAME_UNCHANGED ) {
+      SERVO(timer,channel).ticks = ticks[channel];
+      SERVO(timer,channel).framesLeft = 0;  // a frame write cancels a timed move like a direct write
+    }
+  }
+}
+
+static inline void latch_frame(timer16_Sequence_t timer)
+{
+  if( FramePending & _BV(timer) ) {
+    copy_frame(timer);
+    FramePending &= ~_BV(timer);
+  }
+}
+
+#if SERVO_QUEUE_LENGTH
+// apply the latest due keyframe to the servos of this timer, called at the start of a pulse frame
+static inline void consume_keyframe(timer16_Sequence_t timer)
+{
+  uint8_t tail = QueueTail[timer];
+  uint8_t head = QueueHead;
+  if( tail == head ) {
+    if( QueueStreaming & _BV(timer) )
+      QueueUnderruns[timer]++;   // the main loop did not keep up
+    return;
+  }
+  memory_barrier();
+  unsigned long now = millis();
+  int8_t latest = -1;
+  // older keyframes that are due as well are skipped, only the latest one is pulsed
+  while( tail != head && (long)(now - Queue[tail].due) >= 0 ) {
+    latest = tail;
+    tail = QUEUE_NEXT(tail);
+  }
+  if( latest < 0 )
+    return;   // next keyframe is not due yet
+  for( uint8_t channel = 0; channel < ServosPerTimer; channel++ ) {
+    uint8_t index = SERVO_INDEX(timer,channel);
+    if( index >= SERVO_QUEUE_CHANNELS || index >= ServoCount )
+      break;
+    unsigned int ticks = Queue[latest].ticks[index];
+    if( ticks != FRAME_UNCHANGED ) {
+      servos[index].ticks = ticks;
+      servos[index].framesLeft = 0;  // a keyframe cancels a timed move like a direct write
+    }
+  }
+  memory_barrier();
+  QueueTail[timer] = tail;
+  QueueStreaming |= _BV(timer);
+}
+#else
+#define consume_keyframe(_timer)
+#endif
+
+#if SERVO_STATS
+// ISR instrumentation, per timer
+static servoStats_t Stats[_Nbr_16timers];
+
+static inline void stats_isr(timer16_Sequence_t timer, uint16_t duration)
+{
+  servoStats_t *stats = &Stats[timer];
+  if( duration < stats->isrMin || stats->isrCount == 0 )
+    stats->isrMin = duration;
+  if( duration > stats->isrMax )
+    stats->isrMax = duration;
+  stats->isrSum += duration;
+  stats->isrCount++;
+}
+
+// histogram bin 0 holds errors of 0 ticks, bin n holds 2^(n-1)..2^n-1 ticks, the last bin everything above
+static inline void stats_edge(timer16_Sequence_t timer, int16_t error)
+{
+  uint16_t value = error < 0 ? -error : error;
+  uint8_t bin = 0;
+  while( value && bin < SERVO_STATS_BINS - 1 ) {
+    value >>= 1;
+    bin++;
+  }
+  if( Stats[timer].edgeHistogram[bin] != 0xFFFF )   // saturate instead of wrapping
+    Stats[timer].edgeHistogram[bin]++;
+}
+
+#define STATS_ENTRY()             uint16_t statsEntry = *TCNTn                    // TCNTn at ISR entry
+#define STATS_RESET(_ticks)       statsEntry -= (_ticks)                          // TCNTn was moved back by _ticks
+#define STATS_EDGE(_intended)     stats_edge(timer, (int16_t)(*TCNTn - (_intended)))  // edge is written now
+#define STATS_EXIT()              stats_isr(timer, *TCNTn - statsEntry)
+#else
+#define STATS_ENTRY()
+#define STATS_RESET(_ticks)
+#define STATS_EDGE(_intended)
+#define STATS_EXIT()
+#endif
+
+// pin writes of the ISR, one read-modify-write of the port with SERVO_PORT_WRITE
+#if SERVO_PORT_WRITE
+#define pin_high(_pservo)   (*(_pservo)->outPort |= (_pservo)->bitMask)
+#define pin_low(_pservo)    (*(_pservo)->outPort &= ~(_pservo)->bitMask)
+#else
+#define pin_high(_pservo)   digitalWrite((_pservo)->Pin.nbr, HIGH)
+#define pin_low(_pservo)    digitalWrite((_pservo)->Pin.nbr, LOW)
+#endif
+
+// wait for the refresh period to expire before starting over, the frame started at count start
+static inline void wait_refresh(timer16_Sequence_t timer, volatile uint16_t *TCNTn, volatile uint16_t* OCRnA, uint16_t start)
+{
+  // allow a few ticks to ensure the next OCR1A not missed
+  if( (unsigned long)(uint16_t)(*TCNTn - start) < (unsigned long)(uint16_t)(RefreshTicks[timer] - start) + 4 )
+    *OCRnA = RefreshTicks[timer];  
+  else {
+    *OCRnA = *TCNTn + 4;  // at least the refresh period has elapsed
+    Overruns[timer]++;
+  }
+}
+
+// pulse widths of this frame for the channels pulsed by the ISR: slew limits of each servo, then the travel
+// limit of the timer, shared by the channels in proportion to their steps.  Called at the frame start
+static inline void frame_targets(timer16_Sequence_t timer)
+{
+  unsigned int previous[SERVOS_PER_TIMER_MAX];
+  unsigned int travel = 0;
+  uint8_t channel;
+  for( channel = 0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++ ) {
+    servo_t *pservo = &SERVO(timer,channel);
+    if( pservo->Pin.isActive == true && !pservo->Pin.isHardware ) {
+      previous[channel] = pservo->ticksOut;
+      slew(pservo);
+      travel += pservo->ticksOut > previous[channel] ? pservo->ticksOut - previous[channel] : previous[channel] - pservo->ticksOut;
+    }
+  }
+  unsigned int limit = TravelTicks[timer];
+  if( !limit || travel <= limit )
+    return;
+
+  // scale = limit / travel in 0.8 fixed point, a 16 bit division once per limited frame
+  uint8_t scale = travel < 256 ? (limit << 8) / travel : limit / ((travel + 255) >> 8);
+  for( channel = 0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++ ) {
+    servo_t *pservo = &SERVO(timer,channel);
+    if( pservo->Pin.isActive == true && !pservo->Pin.isHardware && pservo->ticksOut != previous[channel] ) {
+      bool up = pservo->ticksOut > previous[channel];
+      unsigned int step = up ? pservo->ticksOut - previous[channel] : previous[channel] - pservo->ticksOut;
+      step = ((unsigned long)step * scale) >> 8;
+      if( step == 0 )
+        step = 1;   // every servo keeps moving
+      pservo->ticksOut = up ? previous[channel] + step : previous[channel] - step;
+#if SERVO_SLEW
+      if( pservo->maxSpeed || pservo->maxAccel ) {
+        // the slew state continues from the step that was taken
+        pservo->velocity = up ? (int16_t)(step << SLEW_SHIFT) : -(int16_t)(step << SLEW_SHIFT);
+        pservo->slewFrac = 0;
+      }
+#endif
+    }
+  }
+}
+
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT
+
+#define EDGE_GUARD          16      // falling edges closer than this many ticks are handled in the same interrupt
+
+// Pulse start stagger: channel groups (AllocationGroup servos, a leg) rise StaggerTicks apart.
+// The group of each channel is looked up, the ISR does not divide
+#define STAGGER_GROUP(_channel) (ChannelGroups[_channel])
+#define STAGGER_GROUPS      StaggerGroups
+#define STAGGER_ALL         0xFF    // raise_channels: every channel of the frame
+
+static uint8_t ChannelGroups[SERVOS_PER_TIMER_MAX];        // group of each channel of a timer
+static uint8_t StaggerGroups;                               // groups of a timer
+
+// channel groups of the allocation, called before a timer starts
+static void allocate_groups()
+{
+  for( uint8_t channel = 0; channel < SERVOS_PER_TIMER_MAX; channel++ )
+    ChannelGroups[channel] = channel / AllocationGroup;
+  StaggerGroups = ALLOCATION_GROUPS(ServosPerTimer, AllocationGroup);
+}
+
+#if SERVO_STAGGER
+static unsigned int StaggerTicks[_Nbr_16timers];            // rise offset between the channel groups of a timer
+static volatile uint16_t *TimerCounts[_Nbr_16timers];       // TCNTn of the timers that run frames
+static uint8_t StaggerRunning = 0;                          // bit per timer that started a frame
+
+// slot of a channel group: every group of every timer rises in its own slot if the refresh interval has room,
+// the groups of one timer always fit into the interval.  Called when the interval changes
+static void update_stagger(timer16_Sequence_t timer)
+{
+  unsigned int widest = usToTicks(MAX_PULSE_WIDTH) + EDGE_GUARD;
+  unsigned int refresh = RefreshTicks[timer];
+  uint8_t groups = ALLOCATION_GROUPS(ServoCount, AllocationGroup);
+  unsigned int slot = groups > 1 ? refresh / groups : 0;
+  if( slot > widest )
+    slot = widest;
+  if( STAGGER_GROUPS > 1 ) {
+    unsigned int fit = refresh > widest ? (refresh - widest) / (STAGGER_GROUPS - 1) : 0;
+    if( slot > fit )
+      slot = fit;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  StaggerTicks[timer] = slot;
+  SREG = oldSREG;
+}
+
+// count the timer restarts its frame at: 0 for the first timer that runs frames, the other timers are phase locked
+// to it so their groups rise in the slots after the groups of the timers before them.  The count may be
+// "negative" (just below 65536) when the frame starts a little early, all edge times are modulo 65536
+static inline uint16_t stagger_start(timer16_Sequence_t timer, volatile uint16_t *TCNTn)
+{
+  TimerCounts[timer] = TCNTn;
+  StaggerRunning |= _BV(timer);
+  uint8_t reference = 0;
+  while( !(StaggerRunning & _BV(reference)) )
+    reference++;
+  unsigned int refresh = RefreshTicks[timer];
+  if( reference == timer || RefreshTicks[reference] != refresh || StaggerTicks[timer] == 0 )
+    return 0;
+  // the frame of the reference timer started count ticks ago, this one should have started offset ticks later
+  long offset = (long)(timer - reference) * STAGGER_GROUPS * StaggerTicks[timer];
+  long count = (long)*TimerCounts[reference] - offset % refresh;
+  if( count > (long)(refresh / 2) )
+    count -= refresh;
+  // the frame runs up to count refresh, the timer can not count a longer frame
+  if( count <= -(long)(refresh / 2) || count <= (long)refresh - 0x10000L )
+    count += refresh;
+  return (uint16_t)count;
+}
+#define STAGGER_SLOT(_timer)  StaggerTicks[_timer]
+#else
+#define STAGGER_SLOT(_timer)  0
+#endif
+
+#ifdef SERVOEX_HOST
+#define spin_wait()         servoHostTick()   // virtual time only passes while the ISR waits for it
+#else
+#define spin_wait()
+#endif
+
+typedef struct {
+  uint8_t order[SERVOS_PER_TIMER_MAX];  // active channels sorted by falling edge
+  uint16_t fall[SERVOS_PER_TIMER_MAX];  // timer count of the falling edge for each entry of order
+  int8_t count;                     // number of pulses in this frame
+  int8_t next;                      // next falling edge, -1 while waiting for the refresh period
+  uint8_t group;                    // next channel group to rise
+  uint16_t start;                   // timer count the frame started at
+} frame_t;
+
+static frame_t Frames[_Nbr_16timers];
+
+// raise the pins of a channel group, shortest pulse first so falling edges stay sorted
+static inline void raise_channels(frame_t *frame, timer16_Sequence_t timer, volatile uint16_t *TCNTn, uint8_t group)
+{
+  for( int8_t i = 0; i < frame->count; i++ ) {
+    if( group == STAGGER_ALL || STAGGER_GROUP(frame->order[i]) == group ) {
+      servo_t *pservo = &SERVO(timer,frame->order[i]);
+      pin_high(pservo);
+      frame->fall[i] = *TCNTn + pservo->ticksOut;
+    }
+  }
+}
+
+static inline void handle_interrupts(timer16_Sequence_t timer, volatile uint16_t *TCNTn, volatile uint16_t* OCRnA)
+{
+  STATS_ENTRY();
+  frame_t *frame = &Frames[timer];
+
+  uint16_t slot = STAGGER_SLOT(timer);
+
+  if( frame->next < 0 ) {
+    // refresh interval completed, start the frame
+    uint16_t count = *TCNTn;
+#if SERVO_STAGGER
+    *TCNTn = stagger_start(timer, TCNTn);
+#else
+    *TCNTn = 0;
+#endif
+    PeriodTicks[timer] = count - frame->start;
+    STATS_RESET(count - *TCNTn);
+    frame->start = *TCNTn;
+    latch_frame(timer);
+    consume_keyframe(timer);
+    frame_targets(timer);
+
+    // sort channels by falling edge, the rise offset of their group plus the pulse width (insertion sort, at most 12)
+    int8_t active = 0;
+    for( uint8_t channel = 0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++ ) {
+      if( SERVO(timer,channel).Pin.isActive == true && !SERVO(timer,channel).Pin.isHardware ) {
+        uint16_t key = STAGGER_GROUP(channel) * slot + SERVO(timer,channel).ticksOut;
+        int8_t i = active++;
+        for( ; i > 0 && frame->fall[i - 1] > key; i-- ) {
+          frame->order[i] = frame->order[i - 1];
+          frame->fall[i] = frame->fall[i - 1];
+        }
+        frame->order[i] = channel;
+        frame->fall[i] = key;
+      }
+    }
+    // planned falling edges, corrected when the group rises
+    for( int8_t i = 0; i < active; i++ )
+      frame->fall[i] += frame->start;
+    frame->count = active;
+    frame->next = 0;
+
+    // the first group rises now, without stagger every group
+    raise_channels(frame, timer, TCNTn, slot ? 0 : STAGGER_ALL);
+    frame->group = slot ? 1 : STAGGER_GROUPS;
+  }
+
+  // rise the groups and lower the channels that are due in time order, edges within EDGE_GUARD are waited for here
+  for( ;; ) {
+    bool falling = frame->next < frame->count;
+    bool rising = frame->group < STAGGER_GROUPS;
+    uint16_t fall = falling ? frame->fall[frame->next] : 0;
+    uint16_t rise = frame->start + frame->group * slot;
+    // a group rises before the falling edges of its channels, their times are set when it rises
+    if( rising && (!falling || (int16_t)(rise - fall) <= 0) ) {
+      if( (int16_t)(rise - *TCNTn) > EDGE_GUARD ) {
+        *OCRnA = rise;
+        break;
+      }
+      while( (int16_t)(rise - *TCNTn) > 0 )
+        spin_wait();
+      raise_channels(frame, timer, TCNTn, frame->group++);
+    }
+    else if( falling ) {
+      if( (int16_t)(fall - *TCNTn) > EDGE_GUARD ) {
+        *OCRnA = fall;
+        break;
+      }
+      while( (int16_t)(fall - *TCNTn) > 0 )
+        spin_wait();
+      servo_t *pservo = &SERVO(timer,frame->order[frame->next]);
+      STATS_EDGE(fall);
+      pin_low(pservo);
+      update_move(pservo);
+      frame->next++;
+    }
+    else {
+      wait_refresh(timer, TCNTn, OCRnA, frame->start);
+      frame->next = -1; // next compare match starts a new frame
+      break;
+    }
+  }
+  STATS_EXIT();
+}
+
+#else
+
 static inline void handle_interrupts(timer16_Sequence_t timer, volatile uint16_t *TCNTn, volatile uint16_t* OCRnA)
 {
   register servo_t *pservo;
-  if( Channel[timer] < 0 )
+  STATS_ENTRY();
+  if( Channel[timer] < 0 ) {
+    PeriodTicks[timer] = *TCNTn;
     *TCNTn = 0; // channel set to -1 indicated that refresh interval completed so reset the timer 
+    STATS_RESET(PeriodTicks[timer]);
+    latch_frame(timer);
+    consume_keyframe(timer);
+    frame_targets(timer);
+  }
   else{
 	pservo = &SERVO(timer,Channel[timer]);
-    if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && pservo->Pin.isActive == true )  {
-      digitalWrite( pservo->Pin.nbr,LOW); // pulse this channel low if activated   
-	  // See if we are in a timed move, if so update the move for the next time through...
-	  if (pservo->ticksDelta > 0) {
-	    pservo->ticks +=pservo->ticksDelta;
-		if (pservo->ticks >= pservo->ticksNew) {
-			pservo->ticks = pservo->ticksNew;
-			pservo->ticksDelta = 0;
-		}
-	  }
-	  else if (pservo->ticksDelta < 0) {
-	    pservo->ticks +=pservo->ticksDelta;
-		if (pservo->ticks <= pservo->ticksNew) {
-			pservo->ticks = pservo->ticksNew;
-			pservo->ticksDelta = 0;
-		}
-	  }
+    if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && pservo->Pin.isActive == true && !pservo->Pin.isHardware )  {
+      STATS_EDGE(*OCRnA);  // the compare match was the intended falling edge
+      pin_low(pservo); // pulse this channel low if activated
+      update_move(pservo);
 	} 
   }
 
   Channel[timer]++;    // increment to the next channel
-  if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && Channel[timer] < SERVOS_PER_TIMER) {
+  if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && Channel[timer] < ServosPerTimer) {
 	pservo = &SERVO(timer,Channel[timer]);
-    *OCRnA = *TCNTn + pservo->ticks;
-    if(pservo->Pin.isActive == true)     // check if activated
-      digitalWrite( pservo->Pin.nbr,HIGH); // its an active channel so pulse it high  
+    *OCRnA = *TCNTn + pservo->ticksOut;
+    if(pservo->Pin.isActive == true && !pservo->Pin.isHardware)     // check if activated
+      pin_high(pservo); // its an active channel so pulse it high
 
   }  
   else { 
     // finished all channels so wait for the refresh period to expire before starting over 
-    if( (unsigned)*TCNTn <  (usToTicks(REFRESH_INTERVAL) + 4) )  // allow a few ticks to ensure the next OCR1A not missed
-      *OCRnA = (unsigned int)usToTicks(REFRESH_INTERVAL);  
-    else 
-      *OCRnA = *TCNTn + 4;  // at least REFRESH_INTERVAL has elapsed
+    wait_refresh(timer, TCNTn, OCRnA, 0);
     Channel[timer] = -1; // this will get incremented at the end of the refresh period to start again at the first channel
   }
+  STATS_EXIT();
 }
 
+#endif
+
+#if SERVO_HARDWARE_PWM
+
+// Output compare units in fast PWM mode 14: the timer counts from 0 to ICRn (one frame), the outputs are set
+// at 0 and cleared when the count passes OCRnx.  OCRnx is double buffered, a value written during a frame is
+// used from the next one.  A timer runs either in this mode or in normal mode for the ISR scheduler.
+#define HARDWARE_CHANNELS   3                                 // OCnA, OCnB, OCnC
+#define HARDWARE_TRIM       (usToTicks(TRIM_DURATION) - 1)    // the output is high for OCRnx + 1 ticks, ticks are trimmed for the ISR
+
+typedef struct {
+  volatile uint8_t *TCCRnA;
+  volatile uint8_t *TCCRnB;
+  volatile uint8_t *TIFRn;
+  volatile uint8_t *TIMSKn;
+  volatile uint16_t *TCNTn;
+  volatile uint16_t *ICRn;
+  volatile uint16_t *OCRnx[HARDWARE_CHANNELS];
+} hardware_timer_t;
+
+// in timer16_Sequence_t order, the bits of the control registers are the same on every timer
+static const hardware_timer_t HardwareTimers[_Nbr_16timers] = {
+  { &TCCR5A, &TCCR5B, &TIFR5, &TIMSK5, &TCNT5, &ICR5, { &OCR5A, &OCR5B, &OCR5C } },
+  { &TCCR1A, &TCCR1B, &TIFR1, &TIMSK1, &TCNT1, &ICR1, { &OCR1A, &OCR1B, &OCR1C } },
+  { &TCCR3A, &TCCR3B, &TIFR3, &TIMSK3, &TCNT3, &ICR3, { &OCR3A, &OCR3B, &OCR3C } },
+  { &TCCR4A, &TCCR4B, &TIFR4, &TIMSK4, &TCNT4, &ICR4, { &OCR4A, &OCR4B, &OCR4C } },
+};
+static const uint8_t HardwareComBits[HARDWARE_CHANNELS] = { _BV(COM1A1), _BV(COM1B1), _BV(COM1C1) };
+
+typedef struct {
+  uint8_t pin;
+  uint8_t timer;                    // timer16_Sequence_t
+  uint8_t channel;                  // 0 for OCnA, 1 for OCnB, 2 for OCnC
+} hardware_pin_t;
+
+static const hardware_pin_t HardwarePins[] = {
+  { 11, _timer1, 0 }, { 12, _timer1, 1 }, { 13, _timer1, 2 },
+  {  5, _timer3, 0 }, {  2, _timer3, 1 }, {  3, _timer3, 2 },
+  {  6, _timer4, 0 }, {  7, _timer4, 1 }, {  8, _timer4, 2 },
+  { 46, _timer5, 0 }, { 45, _timer5, 1 }, { 44, _timer5, 2 },
+};
+
+static uint8_t HardwareChannels[_Nbr_16timers];             // bit per output compare unit in use, the timer runs in fast PWM mode if not 0
+static uint8_t HardwareServo[_Nbr_16timers][HARDWARE_CHANNELS];  // servo index pulsed by each unit in use
+
+// once per frame: timed moves and slew limits of the hardware channels, the values are used from the next frame
+static inline void handle_hardware(timer16_Sequence_t timer)
+{
+  for( uint8_t channel = 0; channel < HARDWARE_CHANNELS; channel++ ) {
+    if( HardwareChannels[timer] & _BV(channel) ) {
+      servo_t *pservo = &servos[HardwareServo[timer][channel]];
+      update_move(pservo);
+      slew(pservo);
+      *HardwareTimers[timer].OCRnx[channel] = pservo->ticksOut + HARDWARE_TRIM;
+    }
+  }
+}
+
+#ifndef WIRING
+#if defined(_useTimer1)
+SIGNAL (TIMER1_OVF_vect)
+{
+  handle_hardware(_timer1);
+}
+#endif
+
+#if defined(_useTimer3)
+SIGNAL (TIMER3_OVF_vect)
+{
+  handle_hardware(_timer3);
+}
+#endif
+
+#if defined(_useTimer4)
+SIGNAL (TIMER4_OVF_vect)
+{
+  handle_hardware(_timer4);
+}
+#endif
+
+#if defined(_useTimer5)
+SIGNAL (TIMER5_OVF_vect)
+{
+  handle_hardware(_timer5);
+}
+#endif
+#endif
+
+#endif
+
 #ifndef WIRING // Wiring pre-defines signal handlers so don't define any if compiling for the Wiring platform
 // Interrupt handlers for Arduino 
 #if defined(_useTimer1)
@@ -193,6 +881,23 @@ void Timer3Service()
 
 static void initISR(timer16_Sequence_t timer)
 {  
+  if( RefreshTicks[timer] == 0 )   // not set by setRefreshInterval before attach
+    RefreshTicks[timer] = usToTicks(REFRESH_INTERVAL);
+  PeriodTicks[timer] = 0;
+#if SERVO_QUEUE_LENGTH
+  QueueTail[timer] = QueueHead;   // keyframes queued before the timer started were not for its servos
+  QueueUnderruns[timer] = 0;
+#endif
+  Overruns[timer] = 0;
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT
+  allocate_groups();
+  // an empty frame, the first compare match waits for the refresh period
+  Frames[timer].count = 0;
+  Frames[timer].next = 0;
+  Frames[timer].group = STAGGER_GROUPS;
+  Frames[timer].start = 0;
+#endif
+
 #if defined (_useTimer1)
   if(timer == _timer1) {
     TCCR1A = 0;             // normal counting mode 
@@ -253,6 +958,12 @@ static void initISR(timer16_Sequence_t timer)
 
 static void finISR(timer16_Sequence_t timer)
 {
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT && SERVO_STAGGER
+  uint8_t oldSREG = SREG;
+  cli();
+  StaggerRunning &= ~_BV(timer);  // the other timers lock to the next one
+  SREG = oldSREG;
+#endif
     //disable use of the given timer
 #if defined WIRING   // Wiring
   if(timer == _timer1) {
@@ -279,7 +990,7 @@ static void finISR(timer16_Sequence_t timer)
 static boolean isTimerActive(timer16_Sequence_t timer)
 {
   // returns true if any servo is active on this timer
-  for(uint8_t channel=0; channel < SERVOS_PER_TIMER; channel++) {
+  for(uint8_t channel=0; channel < ServosPerTimer; channel++) {
     if(SERVO(timer,channel).Pin.isActive == true)
       return true;
   }
@@ -287,6 +998,150 @@ static boolean isTimerActive(timer16_Sequence_t timer)
 }
 
 
+static unsigned int frameTicks(timer16_Sequence_t timer)
+{
+  // shortest frame that fits the widest pulses of the channels attached to this timer
+  uint8_t count = 0;
+#if SERVO_HARDWARE_PWM
+  if( HardwareChannels[timer] )
+    return usToTicks(MAX_PULSE_WIDTH);                 // output compare pulses overlap, no ISR
+#endif
+  uint8_t slots = 0;
+  for(uint8_t channel=0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++) {
+    if(SERVO(timer,channel).Pin.isActive == true && !SERVO(timer,channel).Pin.isHardware)
+      count++;
+    slots++;
+  }
+  if( count == 0 )
+    return 0;
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT
+  return usToTicks(MAX_PULSE_WIDTH) + EDGE_GUARD;      // all pulses overlap
+#else
+  // pulses follow each other, detached and hardware channels keep their slot without pulsing the pin
+  return slots * (unsigned int)usToTicks(MAX_PULSE_WIDTH);
+#endif
+}
+
+static unsigned int readVolatile(volatile unsigned int *value)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned int result = *value;
+  SREG = oldSREG;
+  return result;
+}
+
+#if SERVO_HARDWARE_PWM
+// output compare unit of the pin, false if the pin has none
+static bool hardware_pin(uint8_t pin, uint8_t *timer, uint8_t *channel)
+{
+  for( uint8_t i = 0; i < sizeof(HardwarePins) / sizeof(HardwarePins[0]); i++ ) {
+    if( HardwarePins[i].pin == pin ) {
+      *timer = HardwarePins[i].timer;
+      *channel = HardwarePins[i].channel;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void start_hardware(timer16_Sequence_t timer)
+{
+  const hardware_timer_t *hw = &HardwareTimers[timer];
+  if( RefreshTicks[timer] == 0 )   // not set by setRefreshInterval
+    RefreshTicks[timer] = usToTicks(REFRESH_INTERVAL);
+  PeriodTicks[timer] = RefreshTicks[timer];
+  Overruns[timer] = 0;
+  *hw->TCCRnB = 0;                          // stop the timer while it is set up
+  *hw->TCCRnA = _BV(WGM11);                 // fast PWM with ICRn as top (mode 14), outputs connected per channel
+  *hw->ICRn = RefreshTicks[timer] - 1;
+  *hw->TCNTn = 0;
+  *hw->TCCRnB = _BV(WGM13) | _BV(WGM12) | _BV(CS11);  // prescaler of 8
+  *hw->TIFRn = _BV(TOV1);                   // clear any pending overflow
+  *hw->TIMSKn = _BV(TOIE1);                 // overflow interrupt only, no compare interrupts
+}
+
+static void stop_hardware(timer16_Sequence_t timer)
+{
+  const hardware_timer_t *hw = &HardwareTimers[timer];
+  *hw->TIMSKn = 0;
+  *hw->TCCRnB = 0;
+  *hw->TCCRnA = 0;
+}
+
+// pulse the servo from the output compare unit of its pin, only if no servo is allocated to the timer of the unit
+static bool attach_hardware(uint8_t index)
+{
+  uint8_t timer, channel;
+  if( !hardware_pin(servos[index].Pin.nbr, &timer, &channel) )
+    return false;
+  if( timer == SERVO_INDEX_TO_TIMER(index) || isTimerActive((timer16_Sequence_t)timer) || (HardwareChannels[timer] & _BV(channel)) )
+    return false;
+  uint8_t oldSREG = SREG;
+  cli();
+  if( !HardwareChannels[timer] )
+    start_hardware((timer16_Sequence_t)timer);
+  HardwareServo[timer][channel] = index;
+  HardwareChannels[timer] |= _BV(channel);
+  servos[index].Pin.isHardware = true;
+  *HardwareTimers[timer].OCRnx[channel] = servos[index].ticksOut + HARDWARE_TRIM;
+  *HardwareTimers[timer].TCCRnA |= HardwareComBits[channel];
+  SREG = oldSREG;
+  return true;
+}
+
+// hand the servo back to the ISR of the timer it is allocated to
+static void detach_hardware(uint8_t index)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  for( uint8_t timer = 0; timer < _Nbr_16timers; timer++ ) {
+    for( uint8_t channel = 0; channel < HARDWARE_CHANNELS; channel++ ) {
+      if( (HardwareChannels[timer] & _BV(channel)) && HardwareServo[timer][channel] == index ) {
+        *HardwareTimers[timer].TCCRnA &= ~HardwareComBits[channel];  // the pin follows its PORT bit again
+        pin_low(&servos[index]);
+        HardwareChannels[timer] &= ~_BV(channel);
+        if( !HardwareChannels[timer] )
+          stop_hardware((timer16_Sequence_t)timer);
+      }
+    }
+  }
+  servos[index].Pin.isHardware = false;
+  SREG = oldSREG;
+}
+
+// a servo is allocated to the timer, its hardware channels go back to the ISR
+static void release_hardware(timer16_Sequence_t timer)
+{
+  for( uint8_t channel = 0; channel < HARDWARE_CHANNELS; channel++ ) {
+    if( HardwareChannels[timer] & _BV(channel) )
+      detach_hardware(HardwareServo[timer][channel]);
+  }
+}
+
+static timer16_Sequence_t hardware_timer(uint8_t index)
+{
+  for( uint8_t timer = 0; timer < _Nbr_16timers; timer++ ) {
+    for( uint8_t channel = 0; channel < HARDWARE_CHANNELS; channel++ ) {
+      if( (HardwareChannels[timer] & _BV(channel)) && HardwareServo[timer][channel] == index )
+        return (timer16_Sequence_t)timer;
+    }
+  }
+  return _Nbr_16timers;
+}
+#endif
+
+// timer that pulses the servo: the timer of its output compare unit in hardware mode, else the one it is allocated to
+static timer16_Sequence_t servo_timer(uint8_t index)
+{
+#if SERVO_HARDWARE_PWM
+  if( servos[index].Pin.isHardware )
+    return hardware_timer(index);
+#endif
+  return SERVO_INDEX_TO_TIMER(index);
+}
+
+
 /****************** end of static functions ******************************/
 
 ServoEx::ServoEx()
@@ -294,9 +1149,13 @@ ServoEx::ServoEx()
   if( ServoCount < MAX_SERVOS) {
     this->servoIndex = ServoCount++;                    // assign a servo index to this instance
 	servos[this->servoIndex].ticks = usToTicks(DEFAULT_PULSE_WIDTH);   // store default values  - 12 Aug 2009
+	servos[this->servoIndex].ticksOut = servos[this->servoIndex].ticks;
   }
   else
     this->servoIndex = INVALID_SERVO ;  // too many servos 
+  this->min = 0;
+  this->max = 0;
+  this->calibrate(0, 180);              // writeCalibrated takes degrees by default
 }
 
 uint8_t ServoEx::attach(int pin)
@@ -306,23 +1165,51 @@ uint8_t ServoEx::attach(int pin)
 
 uint8_t ServoEx::attach(int pin, int min, int max)
 {
-  if(this->servoIndex < MAX_SERVOS ) {
+  if( SERVO_ALLOCATED(this->servoIndex) ) {
+    AllocationFixed = true;
     pinMode( pin, OUTPUT) ;                                   // set servo pin to output
+    digitalWrite( pin, LOW);                                  // also disconnects the pin from its PWM timer
+#if SERVO_HARDWARE_PWM
+    if( servos[this->servoIndex].Pin.isHardware )   // attached again
+      detach_hardware(this->servoIndex);
+#endif
     servos[this->servoIndex].Pin.nbr = pin;  
+    servos[this->servoIndex].outPort = portOutputRegister(digitalPinToPort(pin));
+    servos[this->servoIndex].bitMask = digitalPinToBitMask(pin);
     // todo min/max check: abs(min - MIN_PULSE_WIDTH) /4 < 128 
     this->min  = (MIN_PULSE_WIDTH - min)/4; //resolution of min/max is 4 uS
     this->max  = (MAX_PULSE_WIDTH - max)/4; 
+    // the position of the servo is not known, the first pulse goes straight to the written value
+    servos[this->servoIndex].ticksOut = servos[this->servoIndex].ticks;
+#if SERVO_SLEW
+    servos[this->servoIndex].velocity = 0;
+    servos[this->servoIndex].slewFrac = 0;
+#endif
     // initialize the timer if it has not already been initialized 
     timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
+#if SERVO_HARDWARE_PWM
+    if( HardwareChannels[timer] )
+      release_hardware(timer);   // the timer is needed for the ISR
+    attach_hardware(this->servoIndex);
+#endif
     if(isTimerActive(timer) == false)
       initISR(timer);    
     servos[this->servoIndex].Pin.isActive = true;  // this must be set after the check for isTimerActive
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT && SERVO_STAGGER
+    update_stagger(timer);
+#endif
   } 
   return this->servoIndex ;
 }
 
 void ServoEx::detach()  
 {
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return;
+#if SERVO_HARDWARE_PWM
+  if( servos[this->servoIndex].Pin.isHardware )
+    detach_hardware(this->servoIndex);
+#endif
   servos[this->servoIndex].Pin.isActive = false;  
   timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
   if(isTimerActive(timer) == false) {
@@ -355,8 +1242,29 @@ void ServoEx::writeMicroseconds(int value)
   	value = value - TRIM_DURATION;
     value = usToTicks(value);  // convert to ticks after compensating for interrupt overhead - 12 Aug 2009
 
+    this->writeTicks(value);
+  } 
+}
+
+void ServoEx::writeTicks(unsigned int value)
+{
+  byte channel = this->servoIndex;
+  if( (channel >= 0) && (channel < MAX_SERVOS) )   // ensure channel is valid
+  {  
+    if( value < SERVO_MIN_TICKS() )    // ensure pulse width is valid
+      value = SERVO_MIN_TICKS();
+    else if( value > SERVO_MAX_TICKS() )
+      value = SERVO_MAX_TICKS();
+
 	// Changes to handle multiple servo group move
-	if (GroupMoveActiveCnt)
+#if SERVO_QUEUE_LENGTH
+	if (QueueActive && channel < SERVO_QUEUE_CHANNELS)
+      Queue[QueueHead].ticks[channel] = value;
+	else
+#endif
+	if (FrameActive)
+      FrameTicks[FrameFront ^ 1][channel] = value;
+	else if (GroupMoveActiveCnt)
       servos[channel].ticksPending = value;  
 	else {
       uint8_t oldSREG = SREG;
@@ -367,6 +1275,200 @@ void ServoEx::writeMicroseconds(int value)
   } 
 }
 
+bool ServoEx::setRefreshInterval(unsigned int value)
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) || value > MAX_REFRESH_INTERVAL )
+    return false;
+  timer16_Sequence_t timer = servo_timer(servoIndex);
+  unsigned int ticks = usToTicks(value);
+  if( ticks < frameTicks(timer) )   // the pulses of the attached channels would not fit
+    return false;
+  uint8_t oldSREG = SREG;
+  cli();
+  RefreshTicks[timer] = ticks;
+#if SERVO_HARDWARE_PWM
+  if( HardwareChannels[timer] ) {
+    // ICRn is not double buffered, a count past the new top restarts the frame (one pulse is skipped)
+    const hardware_timer_t *hw = &HardwareTimers[timer];
+    *hw->ICRn = ticks - 1;
+    if( *hw->TCNTn >= ticks - 1 )
+      *hw->TCNTn = 0;
+    PeriodTicks[timer] = ticks;
+  }
+#endif
+  SREG = oldSREG;
+#if SERVO_SCHEDULER == SERVO_SCHEDULER_CONCURRENT && SERVO_STAGGER
+  update_stagger(timer);
+#endif
+  return true;
+}
+
+unsigned int ServoEx::refreshInterval()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return 0;
+  timer16_Sequence_t timer = servo_timer(servoIndex);
+  unsigned int ticks = RefreshTicks[timer] ? RefreshTicks[timer] : usToTicks(REFRESH_INTERVAL);
+  return ticks / (clockCyclesPerMicrosecond() / 8);
+}
+
+float ServoEx::refreshRate()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return 0;
+  unsigned int ticks = readVolatile(&PeriodTicks[servo_timer(servoIndex)]);
+  if( ticks == 0 )   // no frame completed yet
+    return 0;
+  return (float)(F_CPU / 8) / ticks;
+}
+
+unsigned int ServoEx::refreshOverruns()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return 0;
+  return readVolatile(&Overruns[servo_timer(servoIndex)]);
+}
+
+int8_t ServoEx::timer()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return -1;
+  return servo_timer(servoIndex);
+}
+
+unsigned int ServoEx::frameLength()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return 0;
+  return frameTicks(servo_timer(servoIndex)) / (clockCyclesPerMicrosecond() / 8);
+}
+
+#if SERVO_HARDWARE_PWM
+bool ServoEx::hardware()
+{
+  if( this->servoIndex >= MAX_SERVOS )
+    return false;
+  return servos[this->servoIndex].Pin.isHardware;
+}
+#endif
+
+#if SERVO_STATS
+bool ServoEx::stats(servoStats_t *stats)
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return false;
+  timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
+  uint8_t oldSREG = SREG;
+  cli();
+  *stats = Stats[timer];
+  stats->overruns = Overruns[timer];
+  SREG = oldSREG;
+  return true;
+}
+
+void ServoEx::resetStats()
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return;
+  timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
+  uint8_t oldSREG = SREG;
+  cli();
+  memset(&Stats[timer], 0, sizeof(servoStats_t));
+  Overruns[timer] = 0;
+  SREG = oldSREG;
+}
+#endif
+
+#if SERVO_SLEW
+void ServoEx::setSlewLimits(unsigned long maxSpeed, unsigned long maxAccel)
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return;
+  timer16_Sequence_t timer = servo_timer(servoIndex);
+  // limits per frame in 1/16 ticks, frame time in seconds is ticks / (ticks per uS * 1000000)
+  float ticksPerUs = clockCyclesPerMicrosecond() / 8.0f;
+  float frame = (RefreshTicks[timer] ? RefreshTicks[timer] : usToTicks(REFRESH_INTERVAL)) / (ticksPerUs * 1000000.0f);
+  float speed = maxSpeed * ticksPerUs * frame * (1 << SLEW_SHIFT);
+  float accel = maxAccel * ticksPerUs * frame * frame * (1 << SLEW_SHIFT);
+  // a limit that is set stays at least 1/16 tick, the largest is 2047 ticks per frame
+  uint16_t speedLimit = maxSpeed ? (speed < 1 ? 1 : speed > 0x7FFF ? 0x7FFF : (uint16_t)(speed + 0.5f)) : 0;
+  uint16_t accelLimit = maxAccel ? (accel < 1 ? 1 : accel > 0x7FFF ? 0x7FFF : (uint16_t)(accel + 0.5f)) : 0;
+  uint8_t oldSREG = SREG;
+  cli();
+  if( !servos[this->servoIndex].maxSpeed && !servos[this->servoIndex].maxAccel ) {
+    // the pulse followed the written value unlimited, start from rest
+    servos[this->servoIndex].velocity = 0;
+    servos[this->servoIndex].slewFrac = 0;
+  }
+  servos[this->servoIndex].maxSpeed = speedLimit;
+  servos[this->servoIndex].maxAccel = accelLimit;
+  SREG = oldSREG;
+}
+
+unsigned int ServoEx::slewSaturations()
+{
+  if( this->servoIndex >= MAX_SERVOS )
+    return 0;
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned int count = servos[this->servoIndex].slewLimited;
+  SREG = oldSREG;
+  return count;
+}
+#endif
+
+bool ServoEx::setTravelLimit(unsigned int value)
+{
+  if( !SERVO_ALLOCATED(this->servoIndex) )
+    return false;
+  unsigned long ticks = usToTicks((unsigned long)value);
+  uint8_t oldSREG = SREG;
+  cli();
+  TravelTicks[SERVO_INDEX_TO_TIMER(servoIndex)] = ticks > 0xFFFF ? 0xFFFF : ticks;
+  SREG = oldSREG;
+  return true;
+}
+
+bool ServoEx::allocate(uint8_t count, uint8_t group)
+{
+  // servo indices of attached servos are mapped to their timers already
+  if( AllocationFixed || group == 0 || group > SERVOS_PER_TIMER_MAX )
+    return false;
+  ServosPerTimer = ALLOCATION(count, group);
+  AllocationGroup = group;
+  return true;
+}
+
+uint8_t ServoEx::servosPerTimer()
+{
+  return ServosPerTimer;
+}
+
+void ServoEx::calibrate(float value0, float value180)
+{
+  float ticksMin = SERVO_MIN_TICKS();
+  float ticksMax = SERVO_MAX_TICKS();
+  float scale = (ticksMax - ticksMin) / (value180 - value0);
+  this->setCalibration(scale, ticksMin - value0 * scale);
+}
+
+void ServoEx::setCalibration(float ticksPerUnit, float ticksOffset)
+{
+  this->ticksPerUnit = ticksPerUnit;
+  this->ticksOffset = ticksOffset;
+}
+
+void ServoEx::writeCalibrated(float value)
+{
+  float ticks = this->ticksOffset + value * this->ticksPerUnit;
+  // clamp before the conversion to unsigned, NaN goes to the minimum
+  if( !(ticks > SERVO_MIN_TICKS()) )
+    ticks = SERVO_MIN_TICKS();
+  else if( ticks > SERVO_MAX_TICKS() )
+    ticks = SERVO_MAX_TICKS();
+  this->writeTicks((unsigned int)(ticks + 0.5f));
+}
+
 int ServoEx::read() // return the value as degrees
 {
   return  map( this->readMicroseconds()+1, SERVO_MIN(), SERVO_MAX(), 0, 180);     
@@ -390,15 +1492,15 @@ bool ServoEx::attached()
 
 bool ServoEx::moving()
 {
-  return (servos[this->servoIndex].ticksDelta != 0) ;
+  return is_moving(this->servoIndex) ;
 }
 
-void ServoEx::move(int value, unsigned int MoveTime)
+void ServoEx::move(int value, unsigned int MoveTime, uint8_t profile)
 {
 	// For now just do shorthand of start, write and commit
 	ServoGroupMove.start();
 	write(value);
-	ServoGroupMove.commit(MoveTime);
+	ServoGroupMove.commit(MoveTime, profile);
 }
 
 
@@ -415,7 +1517,7 @@ void cServoGroupMove::start(void)
 	GroupMoveActiveCnt++;	// Increment counter to say we are in a group move.
 }
 
-void cServoGroupMove::commit(unsigned int wMoveTime)
+void cServoGroupMove::commit(unsigned int wMoveTime, uint8_t profile)
 {
     uint8_t oldSREG = SREG;
 	uint8_t 
@@ -423,32 +1525,43 @@ void cServoGroupMove::commit(unsigned int wMoveTime)
 	if (GroupMoveActiveCnt) {
 		if ((--GroupMoveActiveCnt) == 0) {
 			// Ok we are back to zero.  Need to convert the move time to number of cycles...
-			// Lets convert the move time into number of Servo Intervals
-			// NOte Refresh_interval is in microseconds and our time was in milliseconds
-			wMoveTime = (wMoveTime + (REFRESH_INTERVAL/2000))/(REFRESH_INTERVAL/1000);
-			if (wMoveTime) {
-				// At least one clock tick so now 
-				for (i=0; i < ServoCount; i++) {
+			// Lets convert the move time into number of Servo Intervals, each timer has its own interval
+			// NOte the refresh interval is in ticks and our time was in milliseconds
+			unsigned int wCycles[_Nbr_16timers];
+			for (i=0; i < _Nbr_16timers; i++) {
+				unsigned long ulInterval = RefreshTicks[i] ? RefreshTicks[i] : usToTicks(REFRESH_INTERVAL);
+				ulInterval = ulInterval * 8 / clockCyclesPerMicrosecond();	// microseconds
+				wCycles[i] = ((unsigned long)wMoveTime * 1000 + ulInterval/2) / ulInterval;
+			}
+			for (i=0; i < ServoCount; i++) {
+				unsigned int wServoCycles = SERVO_ALLOCATED(i) ? wCycles[SERVO_INDEX_TO_TIMER(i)] : 0;
+				if (wServoCycles) {
+					// At least one clock tick so now 
 					if ((servos[i].ticksPending != (unsigned int)-1) && (servos[i].Pin.isActive) && 
 							(servos[i].ticks != servos[i].ticksPending)) {
+						// phase steps from 0 towards 1 (2^32) and the last cycle sets the end point itself, the step is
+						// rounded down so the wServoCycles - 1 steps before it never wrap, even for the longest moves
+						uint32_t wPhaseStep = 0xFFFFFFFFUL / wServoCycles;
 						cli();
+						servos[i].ticksStart = servos[i].ticks;
 						servos[i].ticksNew = servos[i].ticksPending;  
-						servos[i].ticksDelta = (int)((int)servos[i].ticksNew - (int)servos[i].ticks)/ (int)wMoveTime;
-						if (!servos[i].ticksDelta) 
-							servos[i].ticksDelta = (servos[i].ticksNew > servos[i].ticks)? 1 : -1;
+						servos[i].phase = 0;
+						servos[i].phaseStep = wPhaseStep;
+						servos[i].profile = profile;
+						servos[i].framesLeft = wServoCycles;
 						SREG = oldSREG;   
 					}
 				}
-			}
-			else {
-				// less than one clock tick lets just set all of the active ones to their new values...
-				for (i=0; i < ServoCount; i++) {
+				else {
+					// less than one clock tick lets just set all of the active ones to their new values...
 					if ((servos[i].ticksPending != (unsigned int)-1) && (servos[i].Pin.isActive)) {
 						cli();
 						servos[i].ticks = servos[i].ticksPending;  
 						SREG = oldSREG;   
 					}
-					servos[i].ticksDelta = 0;	// make sure they are all cleared out.
+					cli();
+					servos[i].framesLeft = 0;	// make sure they are all cleared out.
+					SREG = oldSREG;   
 				}
 			}
 		}	
@@ -461,22 +1574,187 @@ uint32_t cServoGroupMove::moving(void)
 	uint32_t	ulRet = 0;
 	uint32_t	ulMask = 1;
 	for (i=0; i < ServoCount; i++) {
-		if (servos[i].ticksDelta != 0) 
+		if (is_moving(i)) 
 			ulRet |= ulMask;
 		ulMask <<= 1;	// setup for next servo...
 	}
 	return ulRet;
 }
 
+#if SERVO_SLEW
+uint32_t cServoGroupMove::saturated(void)
+{
+	uint8_t i;
+	uint32_t	ulRet = 0;
+	uint32_t	ulMask = 1;
+	for (i=0; i < ServoCount; i++) {
+		uint8_t oldSREG = SREG;
+		cli();
+		if (servos[i].Pin.isActive && (servos[i].maxSpeed || servos[i].maxAccel) && servos[i].ticksOut != servos[i].ticks)
+			ulRet |= ulMask;
+		SREG = oldSREG;
+		ulMask <<= 1;	// setup for next servo...
+	}
+	return ulRet;
+}
+#endif
+
+#if SERVO_HARDWARE_PWM
+uint32_t cServoGroupMove::hardware(void)
+{
+	uint8_t i;
+	uint32_t	ulRet = 0;
+	uint32_t	ulMask = 1;
+	for (i=0; i < ServoCount; i++) {
+		if (servos[i].Pin.isHardware) 
+			ulRet |= ulMask;
+		ulMask <<= 1;	// setup for next servo...
+	}
+	return ulRet;
+}
+#endif
+
 void cServoGroupMove::wait(uint32_t ulSGMMask)
 {
 	uint8_t i;
 	for (i=0; (i < ServoCount) && ulSGMMask; i++) {
 		if (ulSGMMask & 0x1) { 
 			// We are interested in this servo...
-			while (servos[i].ticksDelta != 0) 
+			while (is_moving(i)) 
 				delay(1);
 		}
 		ulSGMMask >>= 1;
 	}
 }
+
+
+//====================================================================================
+
+void cServoFrame::start(void)
+{
+	uint8_t i;
+	unsigned int *back = FrameTicks[FrameFront ^ 1];
+	if (FrameActive++)
+		return;		// nested start, the outermost publish hands the frame over
+	for (i=0; i < ServoCount; i++)
+		back[i] = FRAME_UNCHANGED;
+}
+
+void cServoFrame::publish(void)
+{
+	uint8_t timer;
+	uint8_t mask = 0;
+	if (!FrameActive || --FrameActive)
+		return;
+	// the last frame is not latched by every timer yet: carry its writes over for the timers still waiting for it,
+	// so publish does not drop them, writes of this frame take precedence.  The timers that latched it already do
+	// not take it again, that would restart the timed moves begun since.  A timer latching it while this runs
+	// takes the same values twice, no timed move can begin in between
+	uint8_t pending = FramePending;
+	if (pending) {
+		unsigned int *front = FrameTicks[FrameFront];
+		unsigned int *back = FrameTicks[FrameFront ^ 1];
+		for (timer=0; timer < _Nbr_16timers; timer++) {
+			if (!(pending & _BV(timer)))
+				continue;
+			for (uint8_t channel=0; channel < ServosPerTimer && SERVO_INDEX(timer,channel) < ServoCount; channel++) {
+				uint8_t i = SERVO_INDEX(timer,channel);
+				if (back[i] == FRAME_UNCHANGED)
+					back[i] = front[i];
+			}
+		}
+	}
+	for (timer=0; timer < _Nbr_16timers; timer++) {
+		if (isTimerActive((timer16_Sequence_t)timer))
+			mask |= _BV(timer);
+	}
+	// two single byte stores, no cli needed: an ISR in between still sees a complete frame in either buffer
+	FrameFront ^= 1;
+	FramePending = mask;
+	// the other timers have no attached servos and latch nothing, write their servos directly (servos written
+	// before attach).  finISR leaves the timer interrupt running and ticks and framesLeft are 16 bit, so with cli
+	uint8_t oldSREG = SREG;
+	cli();
+	for (timer=0; timer < _Nbr_16timers; timer++) {
+		if (!(mask & _BV(timer)))
+			copy_frame((timer16_Sequence_t)timer);
+	}
+	SREG = oldSREG;
+}
+
+bool cServoFrame::pending(void)
+{
+	return FramePending != 0;
+}
+
+//====================================================================================
+
+#if SERVO_QUEUE_LENGTH
+// number of slots the active timers have not consumed yet, the slowest timer counts
+static uint8_t queue_used(void)
+{
+	uint8_t timer;
+	uint8_t used = 0;
+	uint8_t head = QueueHead;
+	for (timer=0; timer < _Nbr_16timers; timer++) {
+		if (isTimerActive((timer16_Sequence_t)timer)) {
+			uint8_t timerUsed = (head - QueueTail[timer]) & QUEUE_MASK;
+			if (timerUsed > used)
+				used = timerUsed;
+		}
+	}
+	return used;
+}
+
+bool cServoQueue::start(unsigned long due)
+{
+	uint8_t i;
+	if (QueueActive)
+		return false;
+	if (queue_used() >= SERVO_QUEUE_LENGTH - 1)
+		return false;	// full, the slot at QueueHead would overwrite the oldest keyframe
+	keyframe_t *keyframe = &Queue[QueueHead];
+	keyframe->due = due;
+	for (i=0; i < SERVO_QUEUE_CHANNELS; i++)
+		keyframe->ticks[i] = FRAME_UNCHANGED;
+	QueueActive = 1;
+	return true;
+}
+
+void cServoQueue::commit(void)
+{
+	if (!QueueActive)
+		return;
+	QueueActive = 0;
+	memory_barrier();
+	QueueHead = QUEUE_NEXT(QueueHead);	// single byte store publishes the keyframe
+}
+
+uint8_t cServoQueue::depth(void)
+{
+	return queue_used();
+}
+
+unsigned int cServoQueue::underruns(void)
+{
+	uint8_t timer;
+	unsigned int count = 0;
+	for (timer=0; timer < _Nbr_16timers; timer++)
+		count += readVolatile(&QueueUnderruns[timer]);
+	return count;
+}
+
+void cServoQueue::clear(void)
+{
+	uint8_t timer;
+	uint8_t oldSREG = SREG;
+	cli();
+	for (timer=0; timer < _Nbr_16timers; timer++) {
+		QueueTail[timer] = QueueHead;
+		QueueUnderruns[timer] = 0;
+	}
+	QueueStreaming = 0;
+	QueueActive = 0;
+	SREG = oldSREG;
+}
+#endif
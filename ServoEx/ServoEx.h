@@ -27,9 +27,19 @@
   The Servos are pulsed in the background using the value most recently written using the write() method
 
   Note that analogWrite of PWM on pins associated with the timer are disabled when the first servo is attached.
-  Timers are seized as needed in groups of 12 servos - 24 servos use two timers, 48 servos will use four.
+  Timers are seized as needed in groups of servos, in the order the servos are created.  By default timers
+  are filled with 12 servos - 24 servos use two timers, 48 servos will use four.  ServoEx::allocate(count, group)
+  spreads count servos evenly over the timers without splitting groups of group servos instead (18 and 3 put
+  the servos of a hexapod on timers 5, 1 and 3 with two legs each).  It is called before the first attach(),
+  SERVO_ALLOCATION_COUNT and SERVO_ALLOCATION_GROUP only set the allocation ServoEx.cpp starts with.
   The sequence used to sieze timers is defined in timers.h
 
+  On the ATmega1280/2560 a servo attached to an output compare pin (OCnA/B/C: pins 11 12 13, 5 2 3, 6 7 8,
+  46 45 44 of timers 1, 3, 4 and 5) whose timer has no servos allocated is pulsed by the timer hardware in
+  fast PWM mode: no edges are written by an ISR and the pulse width has no jitter.  One overflow interrupt per
+  frame updates timed moves and slew limits.  Allocating a servo to such a timer later moves its hardware
+  channels back to the ISR.  Other pins always use the ISR.  SERVO_HARDWARE_PWM 0 turns this off
+
   The methods are:
 
    ServoEx - Class for manipulating servo motors connected to Arduino pins.
@@ -46,8 +56,39 @@
    detach()    - Stops an attached servos from pulsing its i/o pin. 
    
    New methods:
+    allocate(count, group) - Static, spreads count servos over the timers in groups of group servos, 0 fills
+                  every timer.  Returns false once a servo is attached, the allocation is kept then
+    servosPerTimer() - Static, gets the number of servos allocated to each timer
 	moving  	- Returns true if the servo is still moving to it's new location.
-    move	 	- Move the one servo to a new location...
+    move	 	- Move the one servo to a new location, optionally with an ease profile...
+    calibrate(value0, value180) - Sets linear calibration mapping value0..value180 onto the pulse range
+                  the same way write() maps 0..180 degrees (any units, range may be reversed)
+    setCalibration(ticksPerUnit, ticksOffset) - Sets precomputed linear calibration
+    writeCalibrated() - Sets the pulse width in timer ticks as ticksOffset + value * ticksPerUnit,
+                  no map() and no integer degree rounding (0.5 uS resolution)
+    writeTicks()  - Sets the servo pulse width in timer ticks
+    setRefreshInterval(value) - Sets the refresh interval in microseconds of the timer this servo is on,
+                  shared by its group of up to 12 servos.  Returns false if it is longer than
+                  MAX_REFRESH_INTERVAL or the pulses of the attached channels would not fit
+    refreshInterval() - Gets the refresh interval in microseconds of the timer this servo is on
+    refreshRate() - Gets the effective refresh rate in Hz measured from the last completed frame,
+                  lower than 1000000 / refreshInterval() when the frame overran
+    refreshOverruns() - Gets the number of frames whose pulses did not fit into the refresh interval
+    timer()       - Gets the position of the timer this servo is on in the timer sequence, -1 if invalid
+    frameLength() - Gets the worst case frame length in microseconds of the timer this servo is on, the pulses
+                  of all attached channels at their maximum width.  The shortest refresh interval it accepts
+    hardware()    - With SERVO_HARDWARE_PWM 1, returns true if the servo is pulsed by the output compare unit of its
+                  pin instead of the ISR, see below
+    stats(&stats) - With SERVO_STATS 1, copies the ISR duration min/max/mean and the pulse edge error
+                  histogram of the timer this servo is on, all in timer ticks (0.5 uS)
+    resetStats()  - With SERVO_STATS 1, clears the statistics of the timer this servo is on
+    setSlewLimits(maxSpeed, maxAccel) - With SERVO_SLEW 1, limits how fast the pulse width follows writes,
+                  in uS per second and uS per second squared, 0 is no limit.  The ISR steps the pulse
+                  towards the written value once per frame, set the limits after setRefreshInterval
+    slewSaturations() - With SERVO_SLEW 1, gets the number of frames the limits held the pulse back
+    setTravelLimit(value) - Limits the sum of the pulse width changes of the servos allocated to the timer of this
+                  servo to value uS per frame, large steps of many servos are spread over consecutive frames in proportion.
+                  0 is no limit.  Servos pulsed by output compare units are not limited
 	
 	New Class cServoGroupMove - used to start a new group move.  There is one instance of this class
 		defined ServoGroupMove. 
@@ -55,11 +96,41 @@
 	The methods are:	
 
     start 		- Starts a group move.  The servos are not moved until the commit call
-    commit		- Commits the moves(write, writeMicroseconds) that happened since start
+    commit		- Commits the moves(write, writeMicroseconds) that happened since start, optionally with
+				  an ease profile (SERVO_EASE_IN, SERVO_EASE_OUT, SERVO_EASE_IN_OUT), default is linear.
+				  Servos are interpolated from the start to the end point and arrive on the last cycle
+				  of the move time
 
     moving		- Returns a bitmask of the servos that are still moving.  The bits are in the order
 				  the servos were created.
     wait		- Waits for all of the servos defined in the mask are to their end points.
+    saturated	- With SERVO_SLEW 1, returns a bitmask of the servos whose pulse is held back by the slew
+				  limits in the current frame, same bit order as moving
+    hardware	- With SERVO_HARDWARE_PWM 1, returns a bitmask of the servos pulsed by output compare units,
+				  same bit order as moving
+
+	New Class cServoFrame - used to update many servos atomically.  There is one instance of this class
+		defined ServoFrame.
+
+	The methods are:
+
+    start		- Starts a frame.  Writes until publish go to a back buffer, not to the servos (may be nested)
+    publish		- Publishes the back buffer on the outermost call, each timer latches it at the start of its next pulse frame,
+				  so no pulse frame ever mixes old and new values
+    pending		- Returns true while a published frame has not been latched by all timers
+
+	New Class cServoQueue - a ring buffer of timestamped keyframes from the main loop to the ISR, so the
+		main loop can compute several frames ahead.  There is one instance of this class defined ServoQueue.
+		SERVO_QUEUE_LENGTH 0 compiles the class, its storage and the ISR hook out.
+
+	The methods are:
+
+    start		- Starts a keyframe due at the given millis().  Writes until commit go to the keyframe.
+				  Returns false if the queue is full
+    commit		- Queues the keyframe.  Each timer applies the latest due keyframe at the start of a pulse frame
+    depth		- Returns the number of queued keyframes not yet applied by every timer
+    underruns	- Returns the number of frames that started with an empty queue after keyframes were applied
+    clear		- Drops the queued keyframes and resets the underrun count, call it when streaming stops
  
  */
 
@@ -78,7 +149,8 @@
  */
 
 // Say which 16 bit timers can be used and in what order
-#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+// The host backend (SERVOEX_HOST, see ServoHost.h) emulates the ATmega2560 timers
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__) || defined(SERVOEX_HOST)
 #define _useTimer5
 #define _useTimer1 
 #define _useTimer3
@@ -110,26 +182,120 @@ typedef enum { _timer1, _Nbr_16timers } timer16_Sequence_t ;
 #define MIN_PULSE_WIDTH       544     // the shortest pulse sent to a servo  
 #define MAX_PULSE_WIDTH      2400     // the longest pulse sent to a servo 
 #define DEFAULT_PULSE_WIDTH  1500     // default pulse width when servo is attached
-#define REFRESH_INTERVAL    20000     // minumim time to refresh servos in microseconds 
+#define REFRESH_INTERVAL    20000     // default minumim time to refresh servos in microseconds, see setRefreshInterval
+#define MAX_REFRESH_INTERVAL 32000    // longest refresh interval the 16 bit timers can count (prescale of 8)
 
-#define SERVOS_PER_TIMER       12     // the maximum number of servos controlled by one timer 
-#define MAX_SERVOS   (_Nbr_16timers  * SERVOS_PER_TIMER)
+#define SERVOS_PER_TIMER_MAX   12     // the maximum number of servos controlled by one timer 
+
+// Allocation ServoEx.cpp starts with, ServoEx::allocate changes it at run time, see the description at the top
+#ifndef SERVO_ALLOCATION_COUNT
+#define SERVO_ALLOCATION_COUNT  0     // servos spread evenly over the timers, 0 fills every timer
+#endif
+#ifndef SERVO_ALLOCATION_GROUP
+#define SERVO_ALLOCATION_GROUP  3     // servos created one after another that stay on one timer
+#endif
+
+// How the pulses of one timer are scheduled:
+// SEQUENTIAL - one pulse after another, a frame takes up to servosPerTimer() * MAX_PULSE_WIDTH
+//              and may exceed REFRESH_INTERVAL
+// CONCURRENT - pulses rise together at the frame start, or group by group with SERVO_STAGGER, and fall
+//              in order on compare matches, a frame takes the longest pulse width only
+#define SERVO_SCHEDULER_SEQUENTIAL  0
+#define SERVO_SCHEDULER_CONCURRENT  1
+
+#ifndef SERVO_SCHEDULER
+#define SERVO_SCHEDULER SERVO_SCHEDULER_CONCURRENT
+#endif
+
+// Concurrent scheduler: the pulses of each allocation group of channels (a leg) rise in their own
+// slot of the frame and the timers are phase locked, so fewer servos start a pulse - and draw their
+// inrush current - at the same time.  The slot shrinks to what the refresh interval has room for, 0 rises all together
+#ifndef SERVO_STAGGER
+#define SERVO_STAGGER           1
+#endif
+#define MAX_SERVOS   (_Nbr_16timers  * SERVOS_PER_TIMER_MAX)
+
+// Keyframe queue, servos 0..SERVO_QUEUE_CHANNELS-1 are queued, others are written directly, 0 compiles it out
+#ifndef SERVO_QUEUE_LENGTH
+#define SERVO_QUEUE_LENGTH      8     // slots, power of 2, one is kept free
+#endif
+#ifndef SERVO_QUEUE_CHANNELS
+#define SERVO_QUEUE_CHANNELS   18
+#endif
 
 #define INVALID_SERVO         255     // flag indicating an invalid servo index
 
+// ISR instrumentation, 0 compiles it out
+#ifndef SERVO_STATS
+#define SERVO_STATS             0
+#endif
+#define SERVO_STATS_BINS        8     // pulse edge error histogram: 0, 1, 2-3, 4-7, ... 64+ ticks
+
+// The ISR writes pins through the PORTx register and bit attach stored, 0 goes back to digitalWrite
+#ifndef SERVO_PORT_WRITE
+#define SERVO_PORT_WRITE        1
+#endif
+
+// Per servo velocity and acceleration limits applied by the ISR, 0 compiles them out
+#ifndef SERVO_SLEW
+#define SERVO_SLEW              1
+#endif
+
+// Servos on output compare pins pulsed by the timer hardware, see the description at the top
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__) || defined(SERVOEX_HOST)
+#ifndef SERVO_HARDWARE_PWM
+#define SERVO_HARDWARE_PWM      1
+#endif
+#else
+#undef SERVO_HARDWARE_PWM
+#define SERVO_HARDWARE_PWM      0     // no output compare pin table for this board
+#endif
+
+// Velocity profiles of timed moves
+#define SERVO_EASE_LINEAR       0     // constant speed
+#define SERVO_EASE_IN           1     // accelerates from rest
+#define SERVO_EASE_OUT          2     // decelerates to rest
+#define SERVO_EASE_IN_OUT       3     // accelerates and decelerates (smoothstep)
+
 typedef struct  {
   uint8_t nbr        :6 ;             // a pin number from 0 to 63
   uint8_t isActive   :1 ;             // true if this channel is enabled, pin not pulsed if false 
+  uint8_t isHardware :1 ;             // true if the pin is pulsed by an output compare unit, not by the ISR
 } ServoPin_t   ;  
 
 typedef struct {
   ServoPin_t Pin;
+  volatile uint8_t *outPort;        // PORTx register of the pin, set by attach so the ISR does not need digitalWrite
+  uint8_t bitMask;                  // bit of the pin in outPort
   unsigned int ticks;				  // Current Tick count 
   unsigned int ticksNew;			  // New end point tick count
-  int	ticksDelta;					  // How much to change per servo cycle
+  unsigned int ticksStart;			  // Start point of the timed move
+  uint32_t phase;					  // Progress of the timed move, 0.32 fixed point
+  uint32_t phaseStep;				  // How much to change the progress per servo cycle
+  uint16_t framesLeft;				  // Servo cycles to the end point, 0 if not moving
+  uint8_t profile;					  // SERVO_EASE_xxx of the timed move
   unsigned int ticksPending; 		  // New pending value that commit will use.	
+  unsigned int ticksOut;			  // Pulse width of the current frame, follows ticks within the slew limits
+#if SERVO_SLEW
+  int16_t velocity;					  // of ticksOut in 1/16 ticks per frame
+  uint8_t slewFrac;					  // fraction of ticksOut in 1/16 ticks
+  uint16_t maxSpeed;				  // 1/16 ticks per frame, 0 if not limited
+  uint16_t maxAccel;				  // 1/16 ticks per frame per frame, 0 if not limited
+  uint16_t slewLimited;				  // frames the limits held the pulse back, saturates at 65535
+#endif
 } servo_t;
 
+#if SERVO_STATS
+typedef struct {
+  uint16_t isrMin;                  // shortest handle_interrupts run in ticks
+  uint16_t isrMax;                  // longest handle_interrupts run in ticks
+  uint32_t isrSum;                  // isrSum / isrCount is the mean
+  uint32_t isrCount;
+  uint16_t edgeHistogram[SERVO_STATS_BINS];  // falling edges by distance from the intended time, saturates at 65535
+  uint16_t overruns;                // frames longer than the refresh interval, same as refreshOverruns()
+} servoStats_t;
+#endif
+
 class ServoEx
 {
 public:
@@ -143,11 +309,37 @@ public:
   int readMicroseconds();            // returns current pulse width in microseconds for this servo (was read_us() in first release)
   bool attached();                   // return true if this servo is attached, otherwise false 
   bool moving();					 // return true if the servo is still moving  
-  void move(int value, unsigned int MoveTime); // A one servo group move...
+  void move(int value, unsigned int MoveTime, uint8_t profile = SERVO_EASE_LINEAR); // A one servo group move...
+  void calibrate(float value0, float value180); // value0..value180 is mapped onto min..max pulse width given to attach
+  void setCalibration(float ticksPerUnit, float ticksOffset); // ticks = ticksOffset + value * ticksPerUnit
+  void writeCalibrated(float value); // Write pulse width using the linear calibration
+  void writeTicks(unsigned int value); // Write pulse width in timer ticks
+  bool setRefreshInterval(unsigned int value); // refresh interval in microseconds for all servos on the timer of this servo
+  unsigned int refreshInterval();    // refresh interval in microseconds set for the timer of this servo
+  float refreshRate();               // measured frames per second of the timer of this servo, 0 until a frame completes
+  unsigned int refreshOverruns();    // number of frames that took longer than the refresh interval
+  int8_t timer();                    // position of the timer of this servo in the timer sequence, -1 if invalid
+  unsigned int frameLength();        // worst case frame length in microseconds of the timer of this servo
+#if SERVO_HARDWARE_PWM
+  bool hardware();                   // true if the pin is pulsed by the output compare unit of its timer
+#endif
+#if SERVO_STATS
+  bool stats(servoStats_t *stats);   // copies the ISR statistics of the timer of this servo
+  void resetStats();                 // clears the ISR statistics and overruns of the timer of this servo
+#endif
+#if SERVO_SLEW
+  void setSlewLimits(unsigned long maxSpeed, unsigned long maxAccel); // uS per second and uS per second^2, 0 is no limit
+  unsigned int slewSaturations();    // frames the slew limits held the pulse of this servo back
+#endif
+  bool setTravelLimit(unsigned int value); // uS of pulse width change per frame of all servos on the timer, 0 is no limit
+  static bool allocate(uint8_t count, uint8_t group); // spread count servos over the timers in groups, before the first attach
+  static uint8_t servosPerTimer();   // servos allocated to each timer
 private:
    uint8_t servoIndex;               // index into the channel data for this servo
    int8_t min;                       // minimum is this value times 4 added to MIN_PULSE_WIDTH    
    int8_t max;                       // maximum is this value times 4 added to MAX_PULSE_WIDTH   
+   float ticksPerUnit;               // linear calibration used by writeCalibrated
+   float ticksOffset;
 };
 
 
@@ -158,13 +350,45 @@ class cServoGroupMove {
     //ServoGroupMove();
 
     void     start(void);                            // Start a group move
-    void     commit(unsigned int wMoveTime);        // how long in milliseconds the move should take
+    void     commit(unsigned int wMoveTime, uint8_t profile = SERVO_EASE_LINEAR); // how long in milliseconds the move should take
 
     uint32_t moving(void);			    // returns bit mask for which servos are active.
     void     wait(uint32_t ulSGMMask);
+#if SERVO_SLEW
+    uint32_t saturated(void);			    // returns bit mask for which servos are held back by slew limits
+#endif
+#if SERVO_HARDWARE_PWM
+    uint32_t hardware(void);			    // returns bit mask for which servos are pulsed by output compare units
+#endif
 
 };
 
 extern cServoGroupMove ServoGroupMove;
 
+
+class cServoFrame {
+  public:
+    void     start(void);                            // Start filling the back buffer
+    void     publish(void);                          // Hand the back buffer to the ISR
+
+    bool     pending(void);                          // true until every timer has latched the last frame
+};
+
+extern cServoFrame ServoFrame;
+
+
+#if SERVO_QUEUE_LENGTH
+class cServoQueue {
+  public:
+    bool     start(unsigned long due);               // Start a keyframe applied at millis() >= due, false if the queue is full
+    void     commit(void);                           // Queue the keyframe
+
+    uint8_t  depth(void);                            // number of keyframes not consumed by every timer yet
+    unsigned int underruns(void);                    // frames that started with an empty queue, all timers together
+    void     clear(void);                            // drop queued keyframes and reset the underrun count
+};
+
+extern cServoQueue ServoQueue;
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,330 @@
+/*
+  ServoHost.cpp - Virtual timer backend to run ServoEx on a host (Linux) machine, see ServoHost.h
+*/
+
+#ifdef SERVOEX_HOST
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#include "ServoHost.h"
+
+volatile uint8_t SREG;
+volatile uint8_t HostPorts[HOST_PORTS];
+
+#define SERVOEX_HOST_TIMER_DEFINE(_n) \
+  volatile uint16_t TCNT##_n, OCR##_n##A, OCR##_n##B, OCR##_n##C, ICR##_n; \
+  volatile uint8_t TCCR##_n##A, TCCR##_n##B, TIFR##_n, TIMSK##_n;
+
+SERVOEX_HOST_TIMER_DEFINE(1)
+SERVOEX_HOST_TIMER_DEFINE(3)
+SERVOEX_HOST_TIMER_DEFINE(4)
+SERVOEX_HOST_TIMER_DEFINE(5)
+
+namespace
+{
+  typedef struct {
+    volatile uint16_t *TCNTn;
+    volatile uint16_t *OCRnA;
+    volatile uint8_t *TCCRnB;
+    volatile uint8_t *TIMSKn;
+    void (*vector)(void);
+    bool pending;                     // compare match not serviced yet
+    // fast PWM mode
+    volatile uint8_t *TCCRnA;
+    volatile uint16_t *ICRn;
+    volatile uint16_t *OCRnx[3];
+    uint8_t pins[3];                  // OCnA, OCnB, OCnC pins of the Mega
+    void (*overflow)(void);
+    bool overflowPending;
+    uint16_t compare[3];              // OCRnx latched at bottom, the registers are double buffered
+  } host_timer_t;
+
+  static const uint8_t ComBits[3] = { _BV(COM1A1), _BV(COM1B1), _BV(COM1C1) };
+
+  // in AVR vector priority order
+  host_timer_t Timers[] = {
+    { &TCNT1, &OCR1A, &TCCR1B, &TIMSK1, TIMER1_COMPA_vect, false, &TCCR1A, &ICR1, { &OCR1A, &OCR1B, &OCR1C }, { 11, 12, 13 }, TIMER1_OVF_vect, false, { 0 } },
+    { &TCNT3, &OCR3A, &TCCR3B, &TIMSK3, TIMER3_COMPA_vect, false, &TCCR3A, &ICR3, { &OCR3A, &OCR3B, &OCR3C }, { 5, 2, 3 }, TIMER3_OVF_vect, false, { 0 } },
+    { &TCNT4, &OCR4A, &TCCR4B, &TIMSK4, TIMER4_COMPA_vect, false, &TCCR4A, &ICR4, { &OCR4A, &OCR4B, &OCR4C }, { 6, 7, 8 }, TIMER4_OVF_vect, false, { 0 } },
+    { &TCNT5, &OCR5A, &TCCR5B, &TIMSK5, TIMER5_COMPA_vect, false, &TCCR5A, &ICR5, { &OCR5A, &OCR5B, &OCR5C }, { 46, 45, 44 }, TIMER5_OVF_vect, false, { 0 } },
+  };
+
+  uint64_t Ticks = 0;
+  bool InIsr = false;
+
+  bool Tracing = false;
+  uint8_t TracedPorts[HOST_PORTS];    // port levels at the last check
+  std::vector<servoHostEdge_t> Edges;
+
+  // record pins that changed since the last check
+  void checkPorts()
+  {
+    for( uint8_t port = 0; port < HOST_PORTS; port++ ) {
+      uint8_t changed = HostPorts[port] ^ TracedPorts[port];
+      if( !changed )
+        continue;
+      for( uint8_t bit = 0; bit < 8; bit++ ) {
+        if( changed & _BV(bit) ) {
+          servoHostEdge_t edge = { Ticks, (uint8_t)(port * 8 + bit), (uint8_t)((HostPorts[port] >> bit) & 1) };
+          if( Tracing )
+            Edges.push_back(edge);
+        }
+      }
+      TracedPorts[port] = HostPorts[port];
+    }
+  }
+
+  uint64_t IsrTime;                   // host nanoseconds in the handlers
+  unsigned long IsrCount;
+
+  void callIsr(void (*vector)(void))
+  {
+    auto start = std::chrono::steady_clock::now();
+    InIsr = true;
+    vector();
+    InIsr = false;
+    IsrTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    IsrCount++;
+    checkPorts();
+  }
+
+  void serviceInterrupts()
+  {
+    if( InIsr )
+      return;                         // no nesting, serviced after the running ISR returns
+    for( auto& timer : Timers ) {
+      if( timer.pending && (*timer.TIMSKn & _BV(OCIE1A)) ) {   // OCIEnA is the same bit on every timer
+        timer.pending = false;
+        callIsr(timer.vector);
+      }
+      if( timer.overflowPending && (*timer.TIMSKn & _BV(TOIE1)) ) {
+        timer.overflowPending = false;
+        callIsr(timer.overflow);
+      }
+    }
+  }
+
+  bool fastPwm(const host_timer_t& timer)
+  {
+    return (*timer.TCCRnA & _BV(WGM11)) && (*timer.TCCRnB & _BV(WGM12)) && (*timer.TCCRnB & _BV(WGM13));
+  }
+
+  void writePin(uint8_t pin, bool level)
+  {
+    if( level )
+      *portOutputRegister(digitalPinToPort(pin)) |= digitalPinToBitMask(pin);
+    else
+      *portOutputRegister(digitalPinToPort(pin)) &= ~digitalPinToBitMask(pin);
+  }
+
+  // one timer tick in fast PWM mode 14
+  void tickFastPwm(host_timer_t& timer)
+  {
+    if( *timer.TCNTn == *timer.ICRn ) {
+      *timer.TCNTn = 0;               // bottom: latch the compare values, outputs go high
+      for( uint8_t channel = 0; channel < 3; channel++ ) {
+        timer.compare[channel] = *timer.OCRnx[channel];
+        if( *timer.TCCRnA & ComBits[channel] )
+          writePin(timer.pins[channel], HIGH);
+      }
+      return;
+    }
+    (*timer.TCNTn)++;
+    if( *timer.TCNTn == *timer.ICRn )
+      timer.overflowPending = true;   // TOVn is set at top
+    for( uint8_t channel = 0; channel < 3; channel++ ) {
+      if( (*timer.TCCRnA & ComBits[channel]) && *timer.TCNTn == (uint16_t)(timer.compare[channel] + 1) )
+        writePin(timer.pins[channel], LOW);  // high for OCRnx + 1 ticks
+    }
+  }
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+unsigned long millis()
+{
+  return Ticks / 2000;
+}
+
+unsigned long micros()
+{
+  return Ticks / 2;
+}
+
+void delay(unsigned long ms)
+{
+  servoHostRun(ms * 1000);
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  writePin(pin, val);
+  checkPorts();
+}
+
+void servoHostTick()
+{
+  checkPorts();                       // edges written before this tick happened at the current time
+  Ticks++;
+  for( auto& timer : Timers ) {
+    if( *timer.TCCRnB == 0 )
+      continue;                       // timer clock stopped
+    if( fastPwm(timer) ) {
+      tickFastPwm(timer);
+      continue;
+    }
+    (*timer.TCNTn)++;
+    if( *timer.TCNTn == *timer.OCRnA )
+      timer.pending = true;
+  }
+}
+
+void servoHostRun(unsigned long us)
+{
+  uint64_t end = Ticks + (uint64_t)us * 2;
+  while( Ticks < end ) {
+    servoHostTick();
+    serviceInterrupts();
+  }
+}
+
+uint64_t servoHostTicks()
+{
+  return Ticks;
+}
+
+void servoHostTrace(bool enable)
+{
+  checkPorts();
+  Tracing = enable;
+}
+
+const servoHostEdge_t *servoHostEdges(size_t *count)
+{
+  *count = Edges.size();
+  return Edges.data();
+}
+
+void servoHostClearTrace()
+{
+  Edges.clear();
+}
+
+uint64_t servoHostIsrTime(unsigned long *count)
+{
+  *count = IsrCount;
+  return IsrTime;
+}
+
+bool servoHostWriteVcd(const char *path)
+{
+  FILE *file = fopen(path, "w");
+  if( !file )
+    return false;
+
+  bool used[HOST_PORTS * 8] = { false };
+  for( const auto& edge : Edges )
+    used[edge.pin] = true;
+
+  // one printable identifier character per pin
+  // VCD time units are 1, 10 or 100 ns, a timer tick is 500 ns
+  fprintf(file, "$timescale 100 ns $end\n$scope module servos $end\n");
+  for( int pin = 0; pin < HOST_PORTS * 8; pin++ ) {
+    if( used[pin] )
+      fprintf(file, "$var wire 1 %c pin%d $end\n", '!' + pin, pin);
+  }
+  fprintf(file, "$upscope $end\n$enddefinitions $end\n");
+
+  uint64_t last = (uint64_t)-1;
+  for( const auto& edge : Edges ) {
+    if( edge.ticks != last ) {
+      fprintf(file, "#%llu\n", (unsigned long long)edge.ticks * 5);
+      last = edge.ticks;
+    }
+    fprintf(file, "%d%c\n", edge.level, '!' + edge.pin);
+  }
+  fclose(file);
+  return true;
+}
+
+void servoHostReport(FILE *file)
+{
+  static const uint64_t MOVING_TICKS = 2;   // width change of a moving pin, more than the edge jitter
+
+  const int PINS = HOST_PORTS * 8;
+  size_t rising[PINS] = { 0 };        // index + 1 of the last rising edge
+  uint64_t lastWidth[PINS] = { 0 };
+  unsigned long pulses[PINS] = { 0 };
+  uint64_t minWidth[PINS], maxWidth[PINS] = { 0 }, maxStep[PINS] = { 0 };
+  bool high[PINS] = { false }, moving[PINS] = { false };
+  int highCount = 0, movingCount = 0, peakHigh = 0, peakMoving = 0, peakRises = 0;
+  int rises = 0;
+  uint64_t riseTicks = (uint64_t)-1;
+
+  // the width of a pulse is known at its falling edge, so a pulse counts as moving from the rise on
+  // when its width differs from the previous pulse: look ahead to the falling edge
+  std::vector<uint64_t> widths(Edges.size(), 0);
+  for( size_t i = 0; i < Edges.size(); i++ ) {
+    uint8_t pin = Edges[i].pin;
+    if( Edges[i].level )
+      rising[pin] = i + 1;
+    else if( rising[pin] )
+      widths[rising[pin] - 1] = Edges[i].ticks - Edges[rising[pin] - 1].ticks;
+  }
+
+  for( int pin = 0; pin < PINS; pin++ )
+    minWidth[pin] = (uint64_t)-1;
+  for( size_t i = 0; i < Edges.size(); i++ ) {
+    const servoHostEdge_t& edge = Edges[i];
+    if( edge.level ) {
+      if( widths[i] == 0 )
+        continue;                     // pulse still high at the end of the trace
+      uint64_t width = widths[i];
+      uint64_t step = width > lastWidth[edge.pin] ? width - lastWidth[edge.pin] : lastWidth[edge.pin] - width;
+      moving[edge.pin] = lastWidth[edge.pin] && step > MOVING_TICKS;
+      if( lastWidth[edge.pin] && step > maxStep[edge.pin] )
+        maxStep[edge.pin] = step;
+      lastWidth[edge.pin] = width;
+      pulses[edge.pin]++;
+      if( width < minWidth[edge.pin] )
+        minWidth[edge.pin] = width;
+      if( width > maxWidth[edge.pin] )
+        maxWidth[edge.pin] = width;
+      high[edge.pin] = true;
+      highCount++;
+      if( moving[edge.pin] )
+        movingCount++;
+      rises = edge.ticks == riseTicks ? rises + 1 : 1;
+      riseTicks = edge.ticks;
+      if( highCount > peakHigh )
+        peakHigh = highCount;
+      if( movingCount > peakMoving )
+        peakMoving = movingCount;
+      if( rises > peakRises )
+        peakRises = rises;
+    }
+    else if( high[edge.pin] ) {
+      high[edge.pin] = false;
+      highCount--;
+      if( moving[edge.pin] )
+        movingCount--;
+    }
+  }
+
+  for( int pin = 0; pin < PINS; pin++ ) {
+    if( pulses[pin] )
+      fprintf(file, "pin %2d: %lu pulses, %.1f - %.1f uS, largest step %.1f uS\n", pin, pulses[pin], minWidth[pin] / 2.0, maxWidth[pin] / 2.0, maxStep[pin] / 2.0);
+  }
+  fprintf(file, "peak pins high: %d, moving: %d, rising together: %d\n", peakHigh, peakMoving, peakRises);
+}
+
+#endif
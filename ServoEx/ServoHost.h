@@ -0,0 +1,131 @@
+/*
+  ServoHost.h - Virtual timer backend to run ServoEx on a host (Linux) machine
+
+  Build ServoEx.cpp and ServoHost.cpp with SERVOEX_HOST defined, together with the code under test.
+  The backend stands in for <Arduino.h> and <avr/interrupt.h>: it emulates the four 16 bit timers of
+  the ATmega2560 (TCNTn, OCRnA, TCCRnB, TIMSKn) and the output ports, and calls the compare match
+  interrupt handlers of ServoEx on a virtual clock.  Fast PWM mode 14 (top in ICRn) is emulated as well:
+  the output compare pins of the Mega (OCnA/B/C) are set at bottom and cleared after the count passes the
+  OCRnx value latched at bottom, and the overflow interrupt is called at top.  Nothing runs in real time, a second of servo
+  output takes a few milliseconds to simulate.
+
+  Virtual time only advances in servoHostRun, delay() and while handle_interrupts waits for a close
+  pulse edge; the rest of the ISR takes no time.  Interrupts do not nest: compare matches of other
+  timers during an ISR are serviced after it returns, in AVR vector priority order.
+
+  The methods are:
+
+    servoHostRun(us)      - Advances virtual time, firing the timer interrupts that are due
+    servoHostTick()       - Advances virtual time by one timer tick (0.5 uS)
+    servoHostTicks()      - Gets virtual time in timer ticks since start
+    servoHostTrace(on)    - Starts or stops recording pin edges
+    servoHostEdges(&n)    - Gets the recorded edges, n is set to their count
+    servoHostClearTrace() - Drops the recorded edges
+    servoHostWriteVcd(path) - Writes the recorded edges as a VCD file, one wire per pin that toggled
+    servoHostReport(file) - Prints a pulse report of the recorded edges: pulse count, width range and largest
+                            width change between pulses per pin, the peak number of pins high at once,
+                            of moving pins high at once (width changed since the previous pulse of the
+                            pin) and of pins rising at the same tick
+    servoHostIsrTime(&n)  - Gets the host nanoseconds spent in the timer interrupt handlers, n is set to the
+                            number of calls.  Includes the virtual ticks the handlers wait for
+*/
+
+#ifndef _Servo_Host_h_
+#define _Servo_Host_h_
+
+#ifdef SERVOEX_HOST
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+// Arduino core subset used by ServoEx
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+
+#define _BV(bit) (1 << (bit))
+#define clockCyclesPerMicrosecond() ( F_CPU / 1000000L )
+
+extern volatile uint8_t SREG;
+inline void cli() {}
+inline void sei() {}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+// 8 pins per virtual port
+#define digitalPinToPort(P)     ( (P) / 8 + 1 )
+#define digitalPinToBitMask(P)  ( _BV((P) % 8) )
+#define portOutputRegister(P)   ( &HostPorts[(P) - 1] )
+#define HOST_PORTS              9                            // pins 0..71
+extern volatile uint8_t HostPorts[HOST_PORTS];
+
+// 16 bit timers, only the bits ServoEx uses
+#define SERVOEX_HOST_TIMER(_n) \
+  extern volatile uint16_t TCNT##_n, OCR##_n##A, OCR##_n##B, OCR##_n##C, ICR##_n; \
+  extern volatile uint8_t TCCR##_n##A, TCCR##_n##B, TIFR##_n, TIMSK##_n; \
+  extern "C" void TIMER##_n##_COMPA_vect(void); \
+  extern "C" void TIMER##_n##_OVF_vect(void);
+
+SERVOEX_HOST_TIMER(1)
+SERVOEX_HOST_TIMER(3)
+SERVOEX_HOST_TIMER(4)
+SERVOEX_HOST_TIMER(5)
+
+#define CS11    1
+#define CS31    1
+#define CS41    1
+#define CS51    1
+#define OCF1A   1
+#define OCF3A   1
+#define OCF4A   1
+#define OCF5A   1
+#define OCIE1A  1
+#define OCIE3A  1
+#define OCIE4A  1
+#define OCIE5A  1
+#define TOV1    0                   // the bits below are used for every timer
+#define TOIE1   0
+#define WGM11   1
+#define WGM12   3
+#define WGM13   4
+#define COM1A1  7
+#define COM1B1  5
+#define COM1C1  3
+
+#define SIGNAL(vector) extern "C" void vector(void)
+
+// Virtual clock
+typedef struct {
+  uint64_t ticks;                   // virtual time of the edge in timer ticks (0.5 uS)
+  uint8_t pin;
+  uint8_t level;                    // HIGH or LOW after the edge
+} servoHostEdge_t;
+
+void servoHostRun(unsigned long us);
+void servoHostTick();
+uint64_t servoHostTicks();
+void servoHostTrace(bool enable);
+const servoHostEdge_t *servoHostEdges(size_t *count);
+void servoHostClearTrace();
+bool servoHostWriteVcd(const char *path);
+void servoHostReport(FILE *file);
+uint64_t servoHostIsrTime(unsigned long *count);
+
+#endif
+
+#endif